@@ -38,4 +38,29 @@
 /* EasyLogger file log plugin's using max rotate file count */
 #define ELOG_FILE_MAX_ROTATE 5
 
+/* EasyLogger file log plugin's using O_APPEND file descriptor and coalescing buffer instead of stdio.
+ * The buffer is flushed by a timer thread, elog_file_flush or elog_file_deinit must be called before exit.
+ * The high level log is flushed by ELOG_OUTPUT_FLUSH_LVL in elog_cfg.h */
+//#define ELOG_FILE_FD_ENABLE
+
+/* EasyLogger file log plugin's coalescing buffer size */
+//#define ELOG_FILE_FD_BUF_SIZE (64 * 1024)
+
+/* EasyLogger file log plugin's buffer will be flushed by timer when it is not flushed in this time (ms) */
+//#define ELOG_FILE_FD_FLUSH_TIMEOUT 1000
+
+/* EasyLogger file log plugin's using preallocated and mapped file segment, only one process can write it */
+//#define ELOG_FILE_MMAP_ENABLE
+
+/* EasyLogger file log plugin's old log files are renamed by a worker thread instead of the logging thread,
+ * the log file may exceed the max size until the worker has finished the last rotation */
+//#define ELOG_FILE_ROTATE_ASYNC_ENABLE
+
+/* EasyLogger file log plugin's log files are numbered by sequence (xxx.00000001.log) instead of renamed when rotating */
+//#define ELOG_FILE_ROTATE_SEQ_ENABLE
+
+/* EasyLogger file log plugin's file size is counted in memory, it is synchronized with the real size every this
+ * number of writes when the log file is also written by other process, 0: only synchronized before rotating */
+//#define ELOG_FILE_SIZE_SYNC_NUM        1024
+
 #endif /* _ELOG_FILE_CFG_H_ */
@@ -31,11 +31,51 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <time.h>
+#include <sys/syscall.h>
+#ifdef ELOG_ASYNC_OUTPUT_BATCH
+#include <errno.h>
+#include <sys/uio.h>
+#endif
 
 #ifdef ELOG_FILE_ENABLE
 #include <elog_file.h>
 #endif
 static pthread_mutex_t output_lock;
+/* the process info is same in all threads, it will be updated in the child process after fork */
+static char cur_process_info[10] = { 0 };
+
+static void port_update_p_info(void);
+
+/* the digits of sub-second in log time, 0: no sub-second, 3: millisecond, 6: microsecond */
+#ifndef ELOG_PORT_TIME_SUBSEC_DIGITS
+#define ELOG_PORT_TIME_SUBSEC_DIGITS         0
+#endif
+#if ELOG_PORT_TIME_SUBSEC_DIGITS > 9
+    #error "The sub-second digits of log time must be less than 10"
+#endif
+/* the length of "YYYY-MM-DD HH:MM:SS" */
+#define PORT_TIME_SEC_LEN                    19
+/* the coarse clock is enough when the sub-second is less precise than millisecond, it is read by vDSO */
+#if defined(CLOCK_REALTIME_COARSE) && ELOG_PORT_TIME_SUBSEC_DIGITS < 3
+#define PORT_TIME_CLOCK                      CLOCK_REALTIME_COARSE
+#else
+#define PORT_TIME_CLOCK                      CLOCK_REALTIME
+#endif
+
+#ifdef ELOG_TIMESTAMP_ENABLE
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+/* the timestamp counter calibration time (ns) */
+#define PORT_TIMESTAMP_CALIBRATE_NS          10000000
+/* nanosecond of every timestamp counter tick */
+static double timestamp_ns_per_tick = 1.0;
+/* the base timestamp counter and its realtime (ns) */
+static uint64_t timestamp_base = 0;
+static uint64_t timestamp_base_real_ns = 0;
+
+static void port_timestamp_calibrate(void);
+#endif /* ELOG_TIMESTAMP_ENABLE */
 
 /**
  * EasyLogger port initialize
@@ -47,6 +87,13 @@ ElogErrCode elog_port_init(void) {
 
     pthread_mutex_init(&output_lock, NULL);
 
+    port_update_p_info();
+    pthread_atfork(NULL, NULL, port_update_p_info);
+
+#ifdef ELOG_TIMESTAMP_ENABLE
+    port_timestamp_calibrate();
+#endif
+
 #ifdef ELOG_FILE_ENABLE
     elog_file_init();
 #endif
@@ -76,7 +123,7 @@ void elog_port_deinit(void) {
 void elog_port_output(const char *log, size_t size) {
     /* output to terminal */
 #ifdef ELOG_TERMINAL_ENABLE
-    printf("%.*s", (int)size, log);
+    fwrite(log, 1, size, stdout);
 #endif
 
 #ifdef ELOG_FILE_ENABLE
@@ -85,6 +132,83 @@ void elog_port_output(const char *log, size_t size) {
 #endif 
 }
 
+#ifdef ELOG_OUTPUT_FLUSH_LVL
+/**
+ * flush the output port interface, it is called after the high level log is output
+ */
+void elog_port_output_flush(void) {
+#ifdef ELOG_TERMINAL_ENABLE
+    fflush(stdout);
+#endif
+
+#ifdef ELOG_FILE_ENABLE
+    elog_file_flush();
+#endif
+}
+#endif /* ELOG_OUTPUT_FLUSH_LVL */
+
+#ifdef ELOG_ASYNC_OUTPUT_BATCH
+/* max number of iovec for every writev */
+#define PORT_OUTPUT_IOV_MAX_NUM              64
+
+/**
+ * write all log buffer vectors to file descriptor, it will continue writing when it is partial written
+ *
+ * @param fd file descriptor
+ * @param vec log buffer vector
+ * @param num number of log buffer vector
+ */
+static void port_writev(int fd, const ElogLogVec *vec, size_t num) {
+    struct iovec iov[PORT_OUTPUT_IOV_MAX_NUM];
+    size_t iov_num = 0, i = 0, offset = 0;
+    ssize_t written;
+
+    while (i < num) {
+        /* fill the iovec from the part of current log */
+        for (iov_num = 0; iov_num < PORT_OUTPUT_IOV_MAX_NUM && i + iov_num < num; iov_num++) {
+            iov[iov_num].iov_base = (void *) (vec[i + iov_num].log + (iov_num ? 0 : offset));
+            iov[iov_num].iov_len = vec[i + iov_num].size - (iov_num ? 0 : offset);
+        }
+        written = writev(fd, iov, iov_num);
+        if (written < 0) {
+            /* write again when it is interrupted by signal */
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        /* skip the written logs */
+        while (i < num && (size_t) written >= vec[i].size - offset) {
+            written -= vec[i++].size - offset;
+            offset = 0;
+        }
+        offset += written;
+    }
+}
+
+/**
+ * batched output log port interface, it is used by asynchronous output thread
+ *
+ * @param vec log buffer vector
+ * @param num number of log buffer vector
+ */
+void elog_port_output_vec(const ElogLogVec *vec, size_t num) {
+    /* output to terminal */
+#ifdef ELOG_TERMINAL_ENABLE
+    flockfile(stdout);
+    /* the synchronous output log which is buffered by stdio must be output before */
+    fflush(stdout);
+    port_writev(fileno(stdout), vec, num);
+    funlockfile(stdout);
+#endif
+
+#ifdef ELOG_FILE_ENABLE
+    /* write the file */
+    elog_file_write_vec(vec, num);
+#endif
+}
+#endif /* ELOG_ASYNC_OUTPUT_BATCH */
+
 /**
  * output lock
  */
@@ -100,47 +224,159 @@ void elog_port_output_unlock(void) {
 }
 
 
+/**
+ * Format the time to string. The "YYYY-MM-DD HH:MM:SS" part is cached for every thread, it will
+ * be formatted only when the second is changed. The sub-second part is appended by integer formatting.
+ *
+ * @param ts time
+ *
+ * @return time string
+ */
+static const char *port_format_time(const struct timespec *ts) {
+    static ELOG_THREAD_LOCAL char cur_system_time[PORT_TIME_SEC_LEN + 1 + ELOG_PORT_TIME_SUBSEC_DIGITS + 1] = { 0 };
+    static ELOG_THREAD_LOCAL time_t cached_sec = (time_t) -1;
+    struct tm cur_tm;
+
+    /* format the date and time when the second is changed */
+    if (ts->tv_sec != cached_sec) {
+        localtime_r(&ts->tv_sec, &cur_tm);
+        strftime(cur_system_time, PORT_TIME_SEC_LEN + 1, "%Y-%m-%d %T", &cur_tm);
+        cached_sec = ts->tv_sec;
+    }
+
+#if ELOG_PORT_TIME_SUBSEC_DIGITS > 0
+    long subsec = ts->tv_nsec;
+    size_t i;
+
+    for (i = ELOG_PORT_TIME_SUBSEC_DIGITS; i < 9; i++) {
+        subsec /= 10;
+    }
+    cur_system_time[PORT_TIME_SEC_LEN] = '.';
+    for (i = ELOG_PORT_TIME_SUBSEC_DIGITS; i > 0; i--) {
+        cur_system_time[PORT_TIME_SEC_LEN + i] = '0' + subsec % 10;
+        subsec /= 10;
+    }
+    cur_system_time[PORT_TIME_SEC_LEN + 1 + ELOG_PORT_TIME_SUBSEC_DIGITS] = '\0';
+#endif
+
+    return cur_system_time;
+}
+
 /**
  * get current time interface
  *
  * @return current time
  */
 const char *elog_port_get_time(void) {
-    static char cur_system_time[24] = { 0 };
+    struct timespec cur_ts;
 
-    time_t cur_t;
-    struct tm cur_tm;
+    clock_gettime(PORT_TIME_CLOCK, &cur_ts);
+
+    return port_format_time(&cur_ts);
+}
 
-    time(&cur_t);
-    localtime_r(&cur_t, &cur_tm);
+#ifdef ELOG_TIMESTAMP_ENABLE
+/**
+ * read the raw timestamp counter, it is TSC on x86, otherwise it is monotonic clock nanosecond
+ *
+ * @return raw timestamp
+ */
+static uint64_t port_read_timestamp(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
 
-    strftime(cur_system_time, sizeof(cur_system_time), "%Y-%m-%d %T", &cur_tm);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
 
-    return cur_system_time;
+/**
+ * Calibrate the timestamp counter with the realtime clock. It measures the counter frequency
+ * with monotonic clock, then records a pair of base counter and realtime.
+ */
+static void port_timestamp_calibrate(void) {
+    struct timespec start, end, real;
+    uint64_t start_ts, end_ts;
+    double elapsed_ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    start_ts = port_read_timestamp();
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    } while (elapsed_ns < PORT_TIMESTAMP_CALIBRATE_NS);
+    end_ts = port_read_timestamp();
+    timestamp_ns_per_tick = elapsed_ns / (double) (end_ts - start_ts);
+
+    clock_gettime(CLOCK_REALTIME, &real);
+    timestamp_base = port_read_timestamp();
+    timestamp_base_real_ns = (uint64_t) real.tv_sec * 1000000000ULL + real.tv_nsec;
 }
 
+/**
+ * get current raw timestamp interface, it will be converted to time string by
+ * @see elog_port_timestamp_to_time when the log is formatted
+ *
+ * @return raw timestamp
+ */
+uint64_t elog_port_get_timestamp(void) {
+    return port_read_timestamp();
+}
+
+/**
+ * convert the raw timestamp to time string interface
+ *
+ * @param timestamp raw timestamp
+ *
+ * @return time string
+ */
+const char *elog_port_timestamp_to_time(uint64_t timestamp) {
+    struct timespec ts;
+    uint64_t real_ns;
+
+    real_ns = timestamp_base_real_ns + (int64_t) ((double) (int64_t) (timestamp - timestamp_base) * timestamp_ns_per_tick);
+    ts.tv_sec = (time_t) (real_ns / 1000000000ULL);
+    ts.tv_nsec = (long) (real_ns % 1000000000ULL);
+
+    return port_format_time(&ts);
+}
+#endif /* ELOG_TIMESTAMP_ENABLE */
+
 /**
  * get current process name interface
  *
  * @return current process name
  */
 const char *elog_port_get_p_info(void) {
-    static char cur_process_info[10] = { 0 };
-
-    snprintf(cur_process_info, 10, "pid:%04d", getpid());
+    if (cur_process_info[0] == '\0') {
+        port_update_p_info();
+    }
 
     return cur_process_info;
 }
 
+/**
+ * update the process info by current process ID
+ */
+static void port_update_p_info(void) {
+    snprintf(cur_process_info, sizeof(cur_process_info), "pid:%04d", getpid());
+}
+
 /**
  * get current thread name interface
  *
  * @return current thread name
  */
 const char *elog_port_get_t_info(void) {
-    static char cur_thread_info[10] = { 0 };
+    /* "tid:" and the max 10 digits of kernel thread ID */
+    static ELOG_THREAD_LOCAL char cur_thread_info[16] = { 0 };
 
-    snprintf(cur_thread_info, 10, "tid:%04ld", pthread_self());
+    /* the thread ID never changes in the thread, so format it only once */
+    if (cur_thread_info[0] == '\0') {
+        snprintf(cur_thread_info, sizeof(cur_thread_info), "tid:%04ld", (long) syscall(SYS_gettid));
+    }
 
     return cur_thread_info;
 }
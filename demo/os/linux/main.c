@@ -75,6 +75,8 @@ int main(void) {
  */
 void test_elog(void) {
     uint8_t buf[256]= {0};
+    /* the string which is not terminated, it is output by precision */
+    char name[4] = {'E', 'L', 'O', 'G'};
     int i = 0;
 
     for (i = 0; i < sizeof(buf); i++)
@@ -89,6 +91,7 @@ void test_elog(void) {
         log_i("Hello EasyLogger!");
         log_d("Hello EasyLogger!");
         log_v("Hello EasyLogger!");
+        log_d("Hello %.*s!", (int) sizeof(name), name);
 //        elog_raw("Hello EasyLogger!");
         elog_hexdump("test", 16, buf, sizeof(buf));
         sleep(5);
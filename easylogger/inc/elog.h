@@ -33,6 +33,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdarg.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -69,9 +70,24 @@ typedef enum{
 /* output log's level total number */
 #define ELOG_LVL_TOTAL_NUM                   6
 
+/* asynchronous output ring buffer full policy */
+#define ELOG_ASYNC_FULL_TRUNCATE             0 /**< put the part of log which is fit for the space */
+#define ELOG_ASYNC_FULL_DROP_NEWEST          1 /**< drop the whole new log */
+#define ELOG_ASYNC_FULL_DROP_OLDEST          2 /**< drop the oldest logs to make space for new log */
+#define ELOG_ASYNC_FULL_BLOCK                3 /**< wait for the space until timeout */
+
 /* EasyLogger software version number */
 #define ELOG_SW_VERSION                      "2.3.0"
 
+/* thread local storage class specifier, it is used by the thread local line buffer and port */
+#ifndef ELOG_THREAD_LOCAL
+    #if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+        #define ELOG_THREAD_LOCAL            _Thread_local
+    #else
+        #define ELOG_THREAD_LOCAL            __thread
+    #endif
+#endif
+
 /* EasyLogger assert for developer. */
 #ifdef ELOG_ASSERT_ENABLE
     #define ELOG_ASSERT(EXPR)                                                 \
@@ -96,45 +112,112 @@ typedef enum{
     #define elog_debug(tag, ...)
     #define elog_verbose(tag, ...)
 #else /* ELOG_OUTPUT_ENABLE */
-    #define filename(x) strrchr(x,'\\')?strrchr(x,'\\')+1:x
+    /* get the file name without directory, both of '/' and '\\' separator are supported */
+    #define filename(x) (strrchr(x,'/')?strrchr(x,'/')+1:(strrchr(x,'\\')?strrchr(x,'\\')+1:x))
+    /* the file name of current source file, it is calculated at compile time when the compiler supports */
+    #if defined(__FILE_NAME__)
+        #define ELOG_SRC_FILE_NAME           __FILE_NAME__
+    #elif defined(__GNUC__)
+        /* the builtin function on string literal will be folded to constant by compiler */
+        #define ELOG_SRC_FILE_NAME                                                             \
+                (__builtin_strrchr(__FILE__, '/') ? __builtin_strrchr(__FILE__, '/') + 1 :     \
+                (__builtin_strrchr(__FILE__, '\\') ? __builtin_strrchr(__FILE__, '\\') + 1 : __FILE__))
+    #else
+        #define ELOG_SRC_FILE_NAME           filename(__FILE__)
+    #endif
+    #ifdef ELOG_FILTER_CACHE_ENABLE
+        /**
+         * The filter result of every log call site is cached with the filter generation, it is
+         * (generation << 1) | enabled. The cache is updated after the filter is changed, so the
+         * filtered log only costs a load and compare, no lock and string compare.
+         * The cache is bound to the first tag of call site by address, the log with other tag of
+         * the same call site (such as tag variable) is checked without cache.
+         */
+        #define ELOG_FILTER_CHECK(level, tag)                                                     \
+            static ElogFilterCache elog_filter_cache = { 0, NULL };                                \
+            const char *elog_filter_tag = (tag);                                                   \
+            uint32_t elog_filter_now = elog_filter_gen_load() << 1;                                \
+            if (elog_filter_cache.tag_addr != elog_filter_tag                                      \
+                    || (elog_filter_cache.state | 1) != (elog_filter_now | 1)) {                   \
+                if (!elog_filter_cache_update(&elog_filter_cache, level, elog_filter_tag)) {       \
+                    break;                                                                         \
+                }                                                                                  \
+            } else if (elog_filter_cache.state == elog_filter_now) {                               \
+                break;                                                                             \
+            }
+    #else
+        #define ELOG_FILTER_CHECK(level, tag)
+    #endif /* ELOG_FILTER_CACHE_ENABLE */
+    #ifdef ELOG_TOKENIZE_ENABLE
+        /* convert the macro value to string */
+        #define ELOG_TOKEN_STR_(x)           #x
+        #define ELOG_TOKEN_STR(x)            ELOG_TOKEN_STR_(x)
+        /* the file name in token must be string literal, __FILE__ can be shortened by -fmacro-prefix-map
+         * when the compiler doesn't support __FILE_NAME__ */
+        #if defined(__FILE_NAME__)
+            #define ELOG_TOKEN_FILE_NAME     __FILE_NAME__
+        #else
+            #define ELOG_TOKEN_FILE_NAME     __FILE__
+        #endif
+        /**
+         * The level, tag, file name, line number and format of every log are saved to the elog_token
+         * section as a token, so the tag and format must be string literal. Only the token ID and
+         * the packed arguments will be output, the host decoder will convert it to text log.
+         */
+        #define ELOG_TOKEN_OUTPUT(level, tag, format, ...)                                        \
+            do {                                                                               \
+                ELOG_FILTER_CHECK(level, tag)                                                  \
+                static const char elog_token[] __attribute__((section("elog_token"), used)) = \
+                        ELOG_TOKEN_STR(level) "\0" tag "\0" ELOG_TOKEN_FILE_NAME "\0"          \
+                        ELOG_TOKEN_STR(__LINE__) "\0" format;                                  \
+                elog_token_output(level, tag, elog_token, format, ##__VA_ARGS__);             \
+            } while (0)
+        #define ELOG_OUTPUT(level, tag, ...) ELOG_TOKEN_OUTPUT(level, tag, __VA_ARGS__)
+    #else
+        #define ELOG_OUTPUT(level, tag, ...)                                                      \
+            do {                                                                               \
+                ELOG_FILTER_CHECK(level, tag)                                                  \
+                elog_output(level, tag, ELOG_SRC_FILE_NAME, __FUNCTION__, __LINE__, __VA_ARGS__); \
+            } while (0)
+    #endif /* ELOG_TOKENIZE_ENABLE */
     #if ELOG_OUTPUT_LVL >= ELOG_LVL_ASSERT
         #define elog_assert(tag, ...) \
-                elog_output(ELOG_LVL_ASSERT, tag, filename(__FILE__), __FUNCTION__, __LINE__, __VA_ARGS__)
+                ELOG_OUTPUT(ELOG_LVL_ASSERT, tag, __VA_ARGS__)
     #else
         #define elog_assert(tag, ...)
     #endif /* ELOG_OUTPUT_LVL >= ELOG_LVL_ASSERT */
 
     #if ELOG_OUTPUT_LVL >= ELOG_LVL_ERROR
         #define elog_error(tag, ...) \
-                elog_output(ELOG_LVL_ERROR, tag, filename(__FILE__), __FUNCTION__, __LINE__, __VA_ARGS__)
+                ELOG_OUTPUT(ELOG_LVL_ERROR, tag, __VA_ARGS__)
     #else
         #define elog_error(tag, ...)
     #endif /* ELOG_OUTPUT_LVL >= ELOG_LVL_ERROR */
 
     #if ELOG_OUTPUT_LVL >= ELOG_LVL_WARN
         #define elog_warn(tag, ...) \
-                elog_output(ELOG_LVL_WARN, tag, filename(__FILE__), __FUNCTION__, __LINE__, __VA_ARGS__)
+                ELOG_OUTPUT(ELOG_LVL_WARN, tag, __VA_ARGS__)
     #else
         #define elog_warn(tag, ...)
     #endif /* ELOG_OUTPUT_LVL >= ELOG_LVL_WARN */
 
     #if ELOG_OUTPUT_LVL >= ELOG_LVL_INFO
         #define elog_info(tag, ...) \
-                elog_output(ELOG_LVL_INFO, tag, filename(__FILE__), __FUNCTION__, __LINE__, __VA_ARGS__)
+                ELOG_OUTPUT(ELOG_LVL_INFO, tag, __VA_ARGS__)
     #else
         #define elog_info(tag, ...)
     #endif /* ELOG_OUTPUT_LVL >= ELOG_LVL_INFO */
 
     #if ELOG_OUTPUT_LVL >= ELOG_LVL_DEBUG
         #define elog_debug(tag, ...) \
-                elog_output(ELOG_LVL_DEBUG, tag, filename(__FILE__), __FUNCTION__, __LINE__, __VA_ARGS__)
+                ELOG_OUTPUT(ELOG_LVL_DEBUG, tag, __VA_ARGS__)
     #else
         #define elog_debug(tag, ...)
     #endif /* ELOG_OUTPUT_LVL >= ELOG_LVL_DEBUG */
 
     #if ELOG_OUTPUT_LVL == ELOG_LVL_VERBOSE
         #define elog_verbose(tag, ...) \
-                elog_output(ELOG_LVL_VERBOSE, tag, filename(__FILE__), __FUNCTION__, __LINE__, __VA_ARGS__)
+                ELOG_OUTPUT(ELOG_LVL_VERBOSE, tag, __VA_ARGS__)
     #else
         #define elog_verbose(tag, ...)
     #endif /* ELOG_OUTPUT_LVL == ELOG_LVL_VERBOSE */
@@ -156,6 +239,9 @@ typedef enum {
 #define ELOG_FMT_ALL    (ELOG_FMT_LVL|ELOG_FMT_TAG|ELOG_FMT_TIME|ELOG_FMT_P_INFO|ELOG_FMT_T_INFO| \
     ELOG_FMT_DIR|ELOG_FMT_FUNC|ELOG_FMT_LINE)
 
+/* tag level filter hash table size, it is larger than max num to keep the probe sequence short */
+#define ELOG_FILTER_TAG_LVL_TABLE_SIZE       (ELOG_FILTER_TAG_LVL_MAX_NUM + ELOG_FILTER_TAG_LVL_MAX_NUM / 2 + 1)
+
 /* output log's tag filter */
 typedef struct {
     uint8_t level;
@@ -168,7 +254,8 @@ typedef struct {
     uint8_t level;
     char tag[ELOG_FILTER_TAG_MAX_LEN + 1];
     char keyword[ELOG_FILTER_KW_MAX_LEN + 1];
-    ElogTagLvlFilter tag_lvl[ELOG_FILTER_TAG_LVL_MAX_NUM];
+    ElogTagLvlFilter tag_lvl[ELOG_FILTER_TAG_LVL_TABLE_SIZE]; /**< open addressing hash table by tag */
+    size_t tag_lvl_num;
 } ElogFilter, *ElogFilter_t;
 
 /* easy logger */
@@ -187,6 +274,26 @@ typedef struct {
 
 }EasyLogger, *EasyLogger_t;
 
+/* filter cache of log call site */
+typedef struct {
+    uint32_t state;       /**< (filter generation << 1) | enabled */
+    const char *tag_addr; /**< the tag which the state belongs to, it is set only once */
+} ElogFilterCache;
+
+/* log buffer vector for batched output, it is the same as struct iovec */
+typedef struct {
+    const char *log;
+    size_t size;
+} ElogLogVec;
+
+/* asynchronous output statistics */
+typedef struct {
+    size_t dropped[ELOG_LVL_TOTAL_NUM]; /**< dropped or truncated log count of every level */
+    size_t dropped_oldest;              /**< the old line log count which is dropped by ELOG_ASYNC_FULL_DROP_OLDEST */
+    size_t buf_size;                    /**< ring buffer size */
+    size_t buf_used_max;                /**< the max used size of ring buffer */
+} ElogAsyncStat;
+
 /* EasyLogger error code */
 typedef enum {
     ELOG_NO_ERR,
@@ -207,17 +314,39 @@ void elog_set_filter(uint8_t level, const char *tag, const char *keyword);
 void elog_set_filter_lvl(uint8_t level);
 void elog_set_filter_tag(const char *tag);
 void elog_set_filter_kw(const char *keyword);
-void elog_set_filter_tag_lvl(const char *tag, uint8_t level);
+#ifdef ELOG_FILTER_KW_SET_ENABLE
+bool elog_add_filter_kw(const char *keyword, bool exclude);
+void elog_del_filter_kw(const char *keyword);
+void elog_clear_filter_kw(void);
+#endif
+bool elog_set_filter_tag_lvl(const char *tag, uint8_t level);
 uint8_t elog_get_filter_tag_lvl(const char *tag);
+#ifdef ELOG_FILTER_CACHE_ENABLE
+extern volatile uint32_t elog_filter_gen;
+/* the filter generation is increased by the filter setters in any thread */
+#if defined(__GNUC__)
+#define elog_filter_gen_load()          __atomic_load_n(&elog_filter_gen, __ATOMIC_ACQUIRE)
+#else
+#define elog_filter_gen_load()          elog_filter_gen
+#endif
+bool elog_filter_cache_update(ElogFilterCache *cache, uint8_t level, const char *tag);
+#endif
 void elog_raw(const char *format, ...);
 void elog_output(uint8_t level, const char *tag, const char *file, const char *func,
         const long line, const char *format, ...);
+#ifdef ELOG_TOKENIZE_ENABLE
+void elog_token_output(uint8_t level, const char *tag, const char *token, const char *format, ...);
+#endif
 void elog_output_lock_enabled(bool enabled);
 extern void (*elog_assert_hook)(const char* expr, const char* func, size_t line);
 void elog_assert_set_hook(void (*hook)(const char* expr, const char* func, size_t line));
 int8_t elog_find_lvl(const char *log);
 const char *elog_find_tag(const char *log, uint8_t lvl, size_t *tag_len);
 void elog_hexdump(const char *name, uint8_t width, const void *buf, uint16_t size);
+#ifdef ELOG_THREAD_NAME_ENABLE
+void elog_set_thread_name(const char *name);
+const char *elog_get_thread_name(void);
+#endif
 
 #define elog_a(tag, ...)     elog_assert(tag, __VA_ARGS__)
 #define elog_e(tag, ...)     elog_error(tag, __VA_ARGS__)
@@ -280,11 +409,26 @@ void elog_flush(void);
 void elog_async_enabled(bool enabled);
 size_t elog_async_get_log(char *log, size_t size);
 size_t elog_async_get_line_log(char *log, size_t size);
+size_t elog_async_peek(const char **log1, size_t *size1, const char **log2, size_t *size2);
+void elog_async_commit(size_t size);
+#ifdef ELOG_ASYNC_OUTPUT_STAT_ENABLE
+void elog_async_get_stat(ElogAsyncStat *stat);
+void elog_async_clear_stat(void);
+#endif
+#ifdef ELOG_ASYNC_OUTPUT_BATCH
+size_t elog_async_get_log_vec(ElogLogVec *vec, size_t num);
+void elog_async_release_log_vec(void);
+#endif
 
 /* elog_utils.c */
 size_t elog_strcpy(size_t cur_len, char *dst, const char *src);
+size_t elog_strncpy(size_t cur_len, char *dst, const char *src, size_t len);
 size_t elog_cpyln(char *line, const char *log, size_t len);
 void *elog_memcpy(void *dst, const void *src, size_t count);
+#if defined(ELOG_ASYNC_DEFERRED_FORMAT) || defined(ELOG_TOKENIZE_ENABLE)
+size_t elog_args_pack(char *buf, size_t size, const char *format, va_list args);
+int elog_args_snprintf(char *buf, size_t size, const char *format, const char *args);
+#endif
 int elog_setchannel(Log_Channel channel);
 int elog_setlevel(uint8_t lv);
 uint8_t elog_getlevel(void);
@@ -45,20 +45,39 @@
 #define ELOG_FILE_ENABLE
 /* setting static output log level. range: from ELOG_LVL_ASSERT to ELOG_LVL_VERBOSE */
 #define ELOG_OUTPUT_LVL                          ELOG_LVL_VERBOSE
+/* the port output is flushed by elog_port_output_flush() after the log which level is higher than or equal to it is output */
+//#define ELOG_OUTPUT_FLUSH_LVL                    ELOG_LVL_ERROR
 /* enable assert check */
 #define ELOG_ASSERT_ENABLE
 /* buffer size for every line's log */
 #define ELOG_LINE_BUF_SIZE                       1024
+/* each thread packages log in its own line buffer, the output lock is only held when output */
+//#define ELOG_LINE_BUF_THREAD_LOCAL
 /* output line number max length */
 #define ELOG_LINE_NUM_MAX_LEN                    5
 /* output filter's tag max length */
 #define ELOG_FILTER_TAG_MAX_LEN                  10
 /* output filter's keyword max length */
 #define ELOG_FILTER_KW_MAX_LEN                   16
-/* output filter's tag level max num */
+/* output filter's tag level max num, the tags are kept in hash table, so it can be hundreds without lookup cost */
 #define ELOG_FILTER_TAG_LVL_MAX_NUM              5
+/* cache the filter result on every log call site, it is updated when the filter is changed */
+//#define ELOG_FILTER_CACHE_ENABLE
+/* enable the output filter's include and exclude keyword set */
+//#define ELOG_FILTER_KW_SET_ENABLE
+/* output filter's keyword set max num */
+//#define ELOG_FILTER_KW_MAX_NUM                   8
+/* output filter's keyword set max different char num */
+//#define ELOG_FILTER_KW_CHAR_MAX_NUM              32
 /* output newline sign */
 #define ELOG_NEWLINE_SIGN                        "\n"
+/* only output the token ID and binary arguments, the tag and format must be string literal. The
+ * keyword filter is not available, use tools/elog_token_decode.py to decode the log on host */
+//#define ELOG_TOKENIZE_ENABLE
+/* enable elog_set_thread_name(), the thread name will replace the thread info of port */
+//#define ELOG_THREAD_NAME_ENABLE
+/* thread name max length */
+//#define ELOG_THREAD_NAME_MAX_LEN                 16
 /*---------------------------------------------------------------------------*/
 /* enable log color */
 //#define ELOG_COLOR_ENABLE
@@ -78,6 +97,34 @@
 #define ELOG_ASYNC_OUTPUT_BUF_SIZE               (ELOG_LINE_BUF_SIZE * 10)
 /* each asynchronous output's log which must end with newline sign */
 #define ELOG_ASYNC_LINE_OUTPUT
+/* asynchronous output mode using lock free ring buffer, it depends on ELOG_LINE_BUF_THREAD_LOCAL */
+//#define ELOG_ASYNC_OUTPUT_LOCK_FREE
+/* every thread puts log to its own ring, it depends on ELOG_ASYNC_OUTPUT_LOCK_FREE */
+//#define ELOG_ASYNC_OUTPUT_PER_THREAD
+/* merge the per-thread rings by global sequence number to keep the output order */
+//#define ELOG_ASYNC_OUTPUT_PER_THREAD_ORDERED
+/* only copy the format and arguments, the log will be formatted on output thread. It depends on
+ * ELOG_ASYNC_OUTPUT_LOCK_FREE, the format, file and function name must be static string */
+//#define ELOG_ASYNC_DEFERRED_FORMAT
+/* the deferred format log only records the raw timestamp from elog_port_get_timestamp, it will be
+ * converted to time string by elog_port_timestamp_to_time on output thread */
+//#define ELOG_TIMESTAMP_ENABLE
+/* the output thread gets all logs on ring buffer without copy, then outputs them by one
+ * elog_port_output_vec, which must be implemented in port */
+//#define ELOG_ASYNC_OUTPUT_BATCH
+/* the waiting output thread is woken up when the buffered log size reaches the watermark or
+ * timeout (ms), it reduces the wakeup times. The watermark 0 means wake up on every log */
+//#define ELOG_ASYNC_OUTPUT_WAKEUP_WATERMARK       (ELOG_ASYNC_OUTPUT_BUF_SIZE / 4)
+//#define ELOG_ASYNC_OUTPUT_WAKEUP_TIMEOUT         10
+/* the policy when async output buffer is full: ELOG_ASYNC_FULL_TRUNCATE, ELOG_ASYNC_FULL_DROP_NEWEST,
+ * ELOG_ASYNC_FULL_DROP_OLDEST or ELOG_ASYNC_FULL_BLOCK (wait until timeout (ms)) */
+//#define ELOG_ASYNC_OUTPUT_FULL_POLICY            ELOG_ASYNC_FULL_DROP_NEWEST
+//#define ELOG_ASYNC_OUTPUT_BLOCK_TIMEOUT          100
+/* the log whose level is higher than or equal to it will sync output when async output buffer is full */
+//#define ELOG_ASYNC_OUTPUT_FULL_SYNC_LVL          ELOG_LVL_ERROR
+/* count the dropped logs and the max used size of async output buffer, a summary log of the
+ * dropped logs will be output when the buffer has enough space again */
+//#define ELOG_ASYNC_OUTPUT_STAT_ENABLE
 /* asynchronous output mode using POSIX pthread implementation */
 //#define ELOG_ASYNC_OUTPUT_USING_PTHREAD
 /*---------------------------------------------------------------------------*/
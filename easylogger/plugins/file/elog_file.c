@@ -48,13 +48,388 @@
 static QFILE fp = 0;
 #undef NULL
 #define NULL   0
-#else
+#elif !defined(ELOG_FILE_FD_ENABLE) && !defined(ELOG_FILE_MMAP_ENABLE)
 static FILE *fp = NULL;
 #endif
 
+#if defined(ELOG_FILE_FD_ENABLE) && defined(ELOG_FILE_MMAP_ENABLE)
+    #error "The ELOG_FILE_FD_ENABLE and ELOG_FILE_MMAP_ENABLE can not be enabled at the same time"
+#endif
+
+#if defined(ELOG_FILE_FD_ENABLE) || defined(ELOG_FILE_MMAP_ENABLE)
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+
+/* the log file is written by the file descriptor instead of stdio */
+static int fd = -1;
+#endif
+
+#ifdef ELOG_FILE_MMAP_ENABLE
+/* the magic of mapped segment trailer */
+#define ELOG_FILE_MMAP_MAGIC           "ELOGMMAP"
+
+/**
+ * The trailer in the end of mapped segment, it records the real length of logs. The file is truncated
+ * to the real length when it is closed, so the trailer is only found when the process was not exited normally.
+ */
+typedef struct {
+    char magic[8];
+    uint64_t len;
+} ElogFileMapTrailer;
+
+/* the mapped log file segment, it is preallocated to the max size */
+static char *map = NULL;
+static size_t map_size = 0;
+static ElogFileMapTrailer *map_trailer = NULL;
+/* the size of mapped segment which can be written by logs */
+#define map_data_size()                (map_size - sizeof(ElogFileMapTrailer))
+#endif
+
+#ifdef ELOG_FILE_FD_ENABLE
+/* coalescing buffer size */
+#ifndef ELOG_FILE_FD_BUF_SIZE
+#define ELOG_FILE_FD_BUF_SIZE          (64 * 1024)
+#endif
+/* the buffer will be flushed when it is not flushed in this time (ms) */
+#ifndef ELOG_FILE_FD_FLUSH_TIMEOUT
+#define ELOG_FILE_FD_FLUSH_TIMEOUT     1000
+#endif
+
+/* coalescing buffer, it only has the whole logs */
+static char fd_buf[ELOG_FILE_FD_BUF_SIZE];
+static size_t fd_buf_len = 0;
+/* the last flush time (ms) */
+static uint64_t fd_flush_time = 0;
+
+#include <pthread.h>
+
+/* the flush timer thread, it flushes the buffered logs when no more log is written after them */
+static pthread_t fd_flush_thread;
+static pthread_mutex_t fd_flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fd_flush_cond = PTHREAD_COND_INITIALIZER;
+static bool fd_flush_exit = false;
+#endif /* ELOG_FILE_FD_ENABLE */
+
 /* initialize OK flag */
 static bool init_ok = false;
 static ElogFileCfg local_cfg;
+/* the current log file size, it is counted in memory after the file is opened, so the logs written by other
+ * process are only counted when it is synchronized with the real size */
+static size_t file_size = 0;
+/* the file size will be synchronized with the real size every this number of writes, 0: only before rotating */
+#ifndef ELOG_FILE_SIZE_SYNC_NUM
+#define ELOG_FILE_SIZE_SYNC_NUM        0
+#endif
+#if ELOG_FILE_SIZE_SYNC_NUM > 0
+static size_t file_size_sync_count = 0;
+#endif
+
+#ifdef ELOG_FILE_ROTATE_ASYNC_ENABLE
+#include <pthread.h>
+
+/* the newest rotated file is renamed to this temporary name, then it is moved to xxx.log.0 by worker */
+#define ELOG_FILE_ROTATE_SUFFIX        ".rotating"
+
+/* the rotate worker, it renames and removes the old log files out of the logging path */
+static pthread_t rotate_thread;
+static pthread_mutex_t rotate_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rotate_cond = PTHREAD_COND_INITIALIZER;
+static bool rotate_pending = false;
+static bool rotate_exit = false;
+/* the log file name and rotate count of the pending rotation */
+static char rotate_name[256];
+static int rotate_max = 0;
+
+/* the rotation is deferred while the worker is busy, the writes in this time only check it in memory */
+#define elog_file_rotate_ready()       (!__atomic_load_n(&rotate_pending, __ATOMIC_ACQUIRE))
+
+static void elog_file_rotate_worker_start(void);
+static void elog_file_rotate_worker_stop(void);
+#else
+#define elog_file_rotate_ready()       true
+#endif /* ELOG_FILE_ROTATE_ASYNC_ENABLE */
+
+#ifdef ELOG_FILE_ROTATE_SEQ_ENABLE
+#if defined(ELOG_FILE_ROTATE_ASYNC_ENABLE)
+    #error "The ELOG_FILE_ROTATE_SEQ_ENABLE and ELOG_FILE_ROTATE_ASYNC_ENABLE can not be enabled at the same time"
+#endif
+#include <dirent.h>
+
+/* the log files are numbered by the sequence, xxx.log => xxx.00000001.log, the newest file is written */
+static char seq_path[256];
+static unsigned long file_seq = 0;
+#endif /* ELOG_FILE_ROTATE_SEQ_ENABLE */
+
+#ifdef ELOG_FILE_FD_ENABLE
+/*
+ * get the monotonic time (ms)
+ */
+static uint64_t elog_file_fd_get_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * write all data of io vector to the log file, the partial write will be continued
+ */
+static void elog_file_fd_writev(struct iovec *iov, int cnt)
+{
+    ssize_t n;
+
+    while (cnt > 0) {
+        n = writev(fd, iov, cnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        /* skip the written io vector */
+        while (cnt > 0 && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+/*
+ * flush the coalescing buffer and the extra log to the log file by a single writev
+ */
+static void elog_file_fd_flush(const char *log, size_t size)
+{
+    struct iovec iov[2];
+    int cnt = 0;
+
+    if (fd_buf_len) {
+        iov[cnt].iov_base = fd_buf;
+        iov[cnt++].iov_len = fd_buf_len;
+    }
+    if (size) {
+        iov[cnt].iov_base = (void *) log;
+        iov[cnt++].iov_len = size;
+    }
+    if (cnt && fd >= 0) {
+        elog_file_fd_writev(iov, cnt);
+    }
+    fd_buf_len = 0;
+    fd_flush_time = elog_file_fd_get_time();
+}
+
+/*
+ * the flush timer thread, the buffered logs are flushed when they are not flushed in the flush timeout
+ */
+static void *elog_file_fd_flush_timer(void *arg)
+{
+    struct timespec timeout;
+    uint64_t wait_time, elapsed;
+
+    (void) arg;
+
+    pthread_mutex_lock(&fd_flush_mutex);
+    wait_time = ELOG_FILE_FD_FLUSH_TIMEOUT;
+    while (!fd_flush_exit) {
+        clock_gettime(CLOCK_REALTIME, &timeout);
+        timeout.tv_sec += wait_time / 1000;
+        timeout.tv_nsec += (wait_time % 1000) * 1000000;
+        if (timeout.tv_nsec >= 1000000000) {
+            timeout.tv_sec++;
+            timeout.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&fd_flush_cond, &fd_flush_mutex, &timeout);
+        if (fd_flush_exit) {
+            break;
+        }
+        pthread_mutex_unlock(&fd_flush_mutex);
+
+        elog_file_port_lock();
+        wait_time = ELOG_FILE_FD_FLUSH_TIMEOUT;
+        if (fd_buf_len) {
+            elapsed = elog_file_fd_get_time() - fd_flush_time;
+            if (elapsed >= ELOG_FILE_FD_FLUSH_TIMEOUT) {
+                elog_file_fd_flush(NULL, 0);
+            } else {
+                /* wake up again when the buffered logs reach the flush timeout */
+                wait_time = ELOG_FILE_FD_FLUSH_TIMEOUT - elapsed;
+            }
+        }
+        elog_file_port_unlock();
+
+        pthread_mutex_lock(&fd_flush_mutex);
+    }
+    pthread_mutex_unlock(&fd_flush_mutex);
+
+    return NULL;
+}
+
+static void elog_file_fd_flush_timer_start(void)
+{
+    fd_flush_exit = false;
+    pthread_create(&fd_flush_thread, NULL, elog_file_fd_flush_timer, NULL);
+}
+
+static void elog_file_fd_flush_timer_stop(void)
+{
+    pthread_mutex_lock(&fd_flush_mutex);
+    fd_flush_exit = true;
+    pthread_cond_signal(&fd_flush_cond);
+    pthread_mutex_unlock(&fd_flush_mutex);
+    pthread_join(fd_flush_thread, NULL);
+}
+#endif /* ELOG_FILE_FD_ENABLE */
+
+#ifdef ELOG_FILE_MMAP_ENABLE
+/*
+ * preallocate the log file to the page aligned size and map it, the old mapping will be removed.
+ * The size is the data size, the trailer is put after it.
+ */
+static bool elog_file_mmap_segment(size_t size)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+    void *addr;
+
+    if (map) {
+        munmap(map, map_size);
+        map = NULL;
+        map_trailer = NULL;
+    }
+    map_size = (size + sizeof(ElogFileMapTrailer) + page_size - 1) / page_size * page_size;
+    if (posix_fallocate(fd, 0, map_size) != 0
+            || (addr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        map_size = 0;
+        return false;
+    }
+    map = addr;
+    map_trailer = (ElogFileMapTrailer *) (map + map_data_size());
+    memcpy(map_trailer->magic, ELOG_FILE_MMAP_MAGIC, sizeof(map_trailer->magic));
+    map_trailer->len = file_size;
+
+    return true;
+}
+#endif /* ELOG_FILE_MMAP_ENABLE */
+
+/*
+ * open the log file by local configuration
+ */
+static void elog_file_open(void)
+{
+#ifdef ELOG_FILE_ROTATE_SEQ_ENABLE
+    const char *name = seq_path;
+#else
+    const char *name = local_cfg.name;
+#endif
+#if defined(ELOG_FILE_FD_ENABLE)
+    fd = open(name, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+#elif defined(ELOG_FILE_MMAP_ENABLE)
+    off_t size;
+    size_t seg_size = local_cfg.max_size + ELOG_LINE_BUF_SIZE;
+    ElogFileMapTrailer trailer;
+
+    file_size = 0;
+    fd = open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    size = lseek(fd, 0, SEEK_END);
+    if (size > 0) {
+        file_size = (size_t) size;
+        /* the file was not closed normally, so the real length is recorded by the trailer */
+        if ((size_t) size >= sizeof(trailer)
+                && pread(fd, &trailer, sizeof(trailer), size - sizeof(trailer)) == sizeof(trailer)
+                && !memcmp(trailer.magic, ELOG_FILE_MMAP_MAGIC, sizeof(trailer.magic))
+                && trailer.len <= (uint64_t) size - sizeof(trailer)) {
+            file_size = (size_t) trailer.len;
+        }
+        /* the segment must cover the whole file, so the trailer is always in the end of file */
+        if ((size_t) size > seg_size) {
+            seg_size = (size_t) size;
+        }
+    }
+    /* the segment is large enough for the max size and a log which is written after it */
+    if (!elog_file_mmap_segment(seg_size)) {
+        close(fd);
+        fd = -1;
+        file_size = 0;
+        return;
+    }
+#else
+    fp = FOPEN(name, "a+");
+#endif
+}
+
+/*
+ * close the log file, the buffered logs will be written to the log file
+ */
+static void elog_file_close(void)
+{
+#if defined(ELOG_FILE_FD_ENABLE)
+    elog_file_fd_flush(NULL, 0);
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+#elif defined(ELOG_FILE_MMAP_ENABLE)
+    if (map) {
+        munmap(map, map_size);
+        map = NULL;
+        map_trailer = NULL;
+    }
+    if (fd >= 0) {
+        /* remove the preallocated part and trailer */
+        if (ftruncate(fd, file_size) != 0) {
+            /* the real length will be got from the trailer when the file is opened again */
+        }
+        close(fd);
+        fd = -1;
+    }
+#else
+    if (fp) {
+        FCLOSE(fp);
+        fp = NULL;
+    }
+#endif
+}
+
+/*
+ * get the log file size from file system
+ */
+static size_t elog_file_get_size(void)
+{
+    long size;
+
+#if defined(ELOG_FILE_FD_ENABLE)
+    if (fd < 0) {
+        return 0;
+    }
+    size = (long) lseek(fd, 0, SEEK_END);
+    /* the buffered logs will be written to this file */
+    size += size >= 0 ? (long) fd_buf_len : 0;
+#elif defined(ELOG_FILE_MMAP_ENABLE)
+    /* the mapped file is only written by this process, its real length is counted in memory */
+    size = (long) file_size;
+#else
+    if (fp == NULL) {
+        return 0;
+    }
+
+    FSEEK(fp, 0L, SEEK_END);
+    size = FTELL(fp);
+#endif
+
+    return size > 0 ? (size_t) size : 0;
+}
 
 ElogErrCode elog_file_init(void)
 {
@@ -72,56 +447,237 @@ ElogErrCode elog_file_init(void)
 
     elog_file_config(&cfg);
 
+#ifdef ELOG_FILE_FD_ENABLE
+    elog_file_fd_flush_timer_start();
+#endif
+#ifdef ELOG_FILE_ROTATE_ASYNC_ENABLE
+    elog_file_rotate_worker_start();
+#endif
+
     init_ok = true;
 __exit:
     return result;
 }
 
+#ifdef ELOG_FILE_ROTATE_SEQ_ENABLE
 /*
- * rotate the log file xxx.log.n-1 => xxx.log.n, and xxx.log => xxx.log.0
+ * get the length of log file name without extension, xxx.log => xxx
  */
-static bool elog_file_rotate(void)
+static size_t elog_file_seq_stem_len(const char *name)
+{
+    const char *base = strrchr(name, '/'), *ext;
+
+    base = base ? base + 1 : name;
+    ext = strrchr(base, '.');
+    if (ext == NULL || ext == base) {
+        return strlen(name);
+    }
+
+    return ext - name;
+}
+
+/*
+ * make the log file path of the sequence number, xxx.log => xxx.00000001.log
+ */
+static void elog_file_seq_path(char *path, size_t size, unsigned long seq)
+{
+    size_t stem = elog_file_seq_stem_len(local_cfg.name);
+
+    snprintf(path, size, "%.*s.%08lu%s", (int) stem, local_cfg.name, seq, local_cfg.name + stem);
+}
+
+/*
+ * find the newest sequence number of the log files in log directory, it only runs when the file is configured
+ */
+static unsigned long elog_file_seq_find(void)
+{
+    const char *name = local_cfg.name, *base = strrchr(name, '/'), *ext;
+    size_t stem = elog_file_seq_stem_len(name), prefix_len;
+    unsigned long seq, max_seq = 0;
+    char dir[256], *end;
+    struct dirent *ent;
+    DIR *dp;
+
+    base = base ? base + 1 : name;
+    ext = name + stem;
+    prefix_len = ext - base;
+    if (base == name) {
+        snprintf(dir, sizeof(dir), ".");
+    } else {
+        /* keep the slash when the log file is in root directory */
+        snprintf(dir, sizeof(dir), "%.*s", (int) (base - name > 1 ? base - name - 1 : 1), name);
+    }
+
+    if ((dp = opendir(dir)) == NULL) {
+        return 0;
+    }
+    while ((ent = readdir(dp)) != NULL) {
+        if (strncmp(ent->d_name, base, prefix_len) != 0 || ent->d_name[prefix_len] != '.') {
+            continue;
+        }
+        seq = strtoul(ent->d_name + prefix_len + 1, &end, 10);
+        if (end != ent->d_name + prefix_len + 1 && strcmp(end, ext) == 0 && seq > max_seq) {
+            max_seq = seq;
+        }
+    }
+    closedir(dp);
+
+    return max_seq;
+}
+#else
+/*
+ * rename the old log files xxx.log.n-1 => xxx.log.n, and the newest file src => xxx.log.0
+ */
+static bool elog_file_rotate_files(const char *name, const char *src, int max_rotate)
 {
 #define SUFFIX_LEN                     10
-    /* mv xxx.log.n-1 => xxx.log.n, and xxx.log => xxx.log.0 */
+    /* mv xxx.log.n-1 => xxx.log.n, and src => xxx.log.0 */
     int n, err = 0;
     char oldpath[256], newpath[256];
-    size_t base = strlen(local_cfg.name);
-    bool result = true;
+    const char *old;
+    size_t base = strlen(name);
     #ifdef QL_EC600U
     QFILE tmp_fp;
     #else
     FILE *tmp_fp;
     #endif
 
-    memcpy(oldpath, local_cfg.name, base);
-    memcpy(newpath, local_cfg.name, base);
+    memcpy(oldpath, name, base);
+    memcpy(newpath, name, base);
 
-    FCLOSE(fp);
-
-    for (n = local_cfg.max_rotate - 1; n >= 0; --n) {
+    for (n = max_rotate - 1; n >= 0; --n) {
         snprintf(oldpath + base, SUFFIX_LEN, n ? ".%d" : "", n - 1);
         snprintf(newpath + base, SUFFIX_LEN, ".%d", n);
+        old = n ? oldpath : src;
         /* remove the old file */
         if ((tmp_fp = FOPEN(newpath , "r")) != NULL) {
             FCLOSE(tmp_fp);
             REMOVE(newpath);
         }
         /* change the new log file to old file name */
-        if ((tmp_fp = FOPEN(oldpath , "r")) != NULL) {
+        if ((tmp_fp = FOPEN(old , "r")) != NULL) {
             FCLOSE(tmp_fp);
-            err = RENAME(oldpath, newpath);
+            err = RENAME(old, newpath);
         }
 
         if (err < 0) {
-            result = false;
-            goto __exit;
+            return false;
         }
     }
 
-__exit:
+    return true;
+}
+#endif /* ELOG_FILE_ROTATE_SEQ_ENABLE */
+
+#ifdef ELOG_FILE_ROTATE_ASYNC_ENABLE
+/*
+ * the rotate worker thread, it moves the old log files after the logging thread has switched to the new file
+ */
+static void *elog_file_rotate_worker(void *arg)
+{
+    char src[sizeof(rotate_name) + sizeof(ELOG_FILE_ROTATE_SUFFIX)];
+
+    (void) arg;
+    pthread_mutex_lock(&rotate_mutex);
+    while (true) {
+        while (!rotate_pending && !rotate_exit) {
+            pthread_cond_wait(&rotate_cond, &rotate_mutex);
+        }
+        if (!rotate_pending) {
+            break;
+        }
+        pthread_mutex_unlock(&rotate_mutex);
+
+        snprintf(src, sizeof(src), "%s%s", rotate_name, ELOG_FILE_ROTATE_SUFFIX);
+        elog_file_rotate_files(rotate_name, src, rotate_max);
+
+        pthread_mutex_lock(&rotate_mutex);
+        __atomic_store_n(&rotate_pending, false, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&rotate_cond);
+    }
+    pthread_mutex_unlock(&rotate_mutex);
+
+    return NULL;
+}
+
+static void elog_file_rotate_worker_start(void)
+{
+    char src[sizeof(rotate_name) + sizeof(ELOG_FILE_ROTATE_SUFFIX)];
+    FILE *tmp_fp;
+
+    rotate_exit = false;
+    /* the rotation was not finished when the process exited last time, so let the worker finish it */
+    if (local_cfg.name != NULL && strlen(local_cfg.name) > 0) {
+        snprintf(src, sizeof(src), "%s%s", local_cfg.name, ELOG_FILE_ROTATE_SUFFIX);
+        if ((tmp_fp = FOPEN(src, "r")) != NULL) {
+            FCLOSE(tmp_fp);
+            snprintf(rotate_name, sizeof(rotate_name), "%s", local_cfg.name);
+            rotate_max = local_cfg.max_rotate;
+            rotate_pending = true;
+        }
+    }
+    pthread_create(&rotate_thread, NULL, elog_file_rotate_worker, NULL);
+}
+
+static void elog_file_rotate_worker_stop(void)
+{
+    pthread_mutex_lock(&rotate_mutex);
+    rotate_exit = true;
+    pthread_cond_broadcast(&rotate_cond);
+    pthread_mutex_unlock(&rotate_mutex);
+    pthread_join(rotate_thread, NULL);
+}
+#endif /* ELOG_FILE_ROTATE_ASYNC_ENABLE */
+
+/*
+ * rotate the log file xxx.log.n-1 => xxx.log.n, and xxx.log => xxx.log.0
+ */
+static bool elog_file_rotate(void)
+{
+    bool result = true;
+#ifdef ELOG_FILE_ROTATE_ASYNC_ENABLE
+    char src[sizeof(rotate_name) + sizeof(ELOG_FILE_ROTATE_SUFFIX)];
+    bool busy;
+
+    /* the temporary file name is used by the last rotation until the worker has moved it, so keep writing
+     * the current file and rotate it by the next write instead of waiting for the worker in port lock */
+    pthread_mutex_lock(&rotate_mutex);
+    busy = rotate_pending;
+    pthread_mutex_unlock(&rotate_mutex);
+    if (busy) {
+        return true;
+    }
+#endif
+
+    elog_file_close();
+
+#ifdef ELOG_FILE_ROTATE_ASYNC_ENABLE
+    /* only switch to the new file here, the old files are moved by the worker */
+    snprintf(src, sizeof(src), "%s%s", local_cfg.name, ELOG_FILE_ROTATE_SUFFIX);
+    if (RENAME(local_cfg.name, src) < 0) {
+        result = false;
+    } else {
+        pthread_mutex_lock(&rotate_mutex);
+        snprintf(rotate_name, sizeof(rotate_name), "%s", local_cfg.name);
+        rotate_max = local_cfg.max_rotate;
+        __atomic_store_n(&rotate_pending, true, __ATOMIC_RELEASE);
+        pthread_cond_signal(&rotate_cond);
+        pthread_mutex_unlock(&rotate_mutex);
+    }
+#elif defined(ELOG_FILE_ROTATE_SEQ_ENABLE)
+    /* only create the next file and remove the oldest file, the other files are not renamed */
+    if (local_cfg.max_rotate >= 0 && file_seq >= (unsigned long) local_cfg.max_rotate) {
+        elog_file_seq_path(seq_path, sizeof(seq_path), file_seq - local_cfg.max_rotate);
+        REMOVE(seq_path);
+    }
+    elog_file_seq_path(seq_path, sizeof(seq_path), ++file_seq);
+#else
+    result = elog_file_rotate_files(local_cfg.name, local_cfg.name, local_cfg.max_rotate);
+#endif
+
     /* reopen the file */
-    fp = FOPEN(local_cfg.name, "a+");
+    elog_file_open();
+    file_size = elog_file_get_size();
 
     return result;
 }
@@ -129,17 +685,34 @@ __exit:
 
 void elog_file_write(const char *log, size_t size)
 {
-    size_t file_size = 0;
+    ElogLogVec vec = { log, size };
 
-    ELOG_ASSERT(init_ok);
     ELOG_ASSERT(log);
 
-    elog_file_port_lock();
+    elog_file_write_vec(&vec, 1);
+}
 
-    FSEEK(fp, 0L, SEEK_END);
-    file_size = FTELL(fp);
+/*
+ * write the batched logs, the file size is checked and the cache is flushed only once
+ */
+void elog_file_write_vec(const ElogLogVec *vec, size_t num)
+{
+    size_t i;
+
+    ELOG_ASSERT(init_ok);
+    ELOG_ASSERT(vec);
 
-    if (unlikely(file_size > local_cfg.max_size)) {
+    elog_file_port_lock();
+
+#if ELOG_FILE_SIZE_SYNC_NUM > 0
+    if (++file_size_sync_count >= ELOG_FILE_SIZE_SYNC_NUM) {
+        file_size_sync_count = 0;
+        file_size = elog_file_get_size();
+    }
+#endif
+    /* the file may be changed by other process, so get the real size before rotating */
+    if (unlikely(file_size > local_cfg.max_size) && elog_file_rotate_ready()
+            && (file_size = elog_file_get_size()) > local_cfg.max_size) {
 #if ELOG_FILE_MAX_ROTATE > 0
         if (!elog_file_rotate()) {
             goto __exit;
@@ -149,24 +722,115 @@ void elog_file_write(const char *log, size_t size)
 #endif
     }
 
-    FWRITE((unsigned char*)log, size, 1, fp);
+#if defined(ELOG_FILE_MMAP_ENABLE)
+    for (i = 0; i < num; i++) {
+        if (unlikely(map == NULL || file_size + vec[i].size > map_data_size())) {
+            if (file_size <= local_cfg.max_size) {
+                /* the batched logs are larger than the rest of segment, so enlarge the segment */
+                if (fd < 0 || !elog_file_mmap_segment(file_size + vec[i].size)) {
+                    goto __exit;
+                }
+            } else {
+#if ELOG_FILE_MAX_ROTATE > 0
+                /* the segment is full, rotate it and map a new segment */
+                if (!elog_file_rotate()) {
+                    goto __exit;
+                }
+#ifdef ELOG_FILE_ROTATE_ASYNC_ENABLE
+                /* the rotation is deferred while the worker is busy, so enlarge the full segment */
+                if (map != NULL && file_size + vec[i].size > map_data_size()
+                        && !elog_file_mmap_segment(file_size + vec[i].size)) {
+                    goto __exit;
+                }
+#endif
+#endif
+                if (map == NULL || file_size + vec[i].size > map_data_size()) {
+                    continue;
+                }
+            }
+        }
+        /* append the log to page cache without system call */
+        memcpy(map + file_size, vec[i].log, vec[i].size);
+        file_size += vec[i].size;
+        map_trailer->len = file_size;
+    }
+#elif defined(ELOG_FILE_FD_ENABLE)
+    for (i = 0; i < num; i++) {
+        if (fd_buf_len + vec[i].size > ELOG_FILE_FD_BUF_SIZE) {
+            /* the log is larger than buffer, so write it with the buffered logs directly */
+            if (vec[i].size > ELOG_FILE_FD_BUF_SIZE / 2) {
+                elog_file_fd_flush(vec[i].log, vec[i].size);
+                file_size += vec[i].size;
+                continue;
+            }
+            elog_file_fd_flush(NULL, 0);
+        }
+        memcpy(fd_buf + fd_buf_len, vec[i].log, vec[i].size);
+        fd_buf_len += vec[i].size;
+        file_size += vec[i].size;
+    }
+    /* flush by time, so the lost log is bounded when the process crashed. The high level log is flushed by
+     * elog_file_flush when ELOG_OUTPUT_FLUSH_LVL is enabled */
+    if (fd_buf_len && elog_file_fd_get_time() - fd_flush_time >= ELOG_FILE_FD_FLUSH_TIMEOUT) {
+        elog_file_fd_flush(NULL, 0);
+    }
+#else
+    for (i = 0; i < num; i++) {
+        FWRITE((unsigned char*)vec[i].log, vec[i].size, 1, fp);
+        file_size += vec[i].size;
+    }
 
 #ifdef ELOG_FILE_FLUSH_CACHE_ENABLE
     fflush(fp);
 #endif
+#endif /* ELOG_FILE_FD_ENABLE */
 
 __exit:
     elog_file_port_unlock();
 }
 
+/*
+ * write the buffered logs to the log file, it can be called periodically to bound the lost logs.
+ * The logs which are buffered by ELOG_FILE_FD_ENABLE will be lost when the process exits, so it
+ * (or elog_file_deinit) must be called before exit.
+ */
+void elog_file_flush(void)
+{
+    ELOG_ASSERT(init_ok);
+
+    elog_file_port_lock();
+#if defined(ELOG_FILE_FD_ENABLE)
+    elog_file_fd_flush(NULL, 0);
+#elif defined(ELOG_FILE_MMAP_ENABLE)
+    if (map) {
+        msync(map, file_size, MS_ASYNC);
+    }
+#elif !defined(QL_EC600U)
+    if (fp) {
+        fflush(fp);
+    }
+#endif
+    elog_file_port_unlock();
+}
+
 void elog_file_deinit(void)
 {
     ELOG_ASSERT(init_ok);
 
     ElogFileCfg cfg = {NULL, 0, 0};
 
+#ifdef ELOG_FILE_FD_ENABLE
+    elog_file_fd_flush_timer_stop();
+#endif
+
+    /* the buffered logs are flushed when the file is closed */
     elog_file_config(&cfg);
 
+#ifdef ELOG_FILE_ROTATE_ASYNC_ENABLE
+    /* the pending rotation will be finished before the worker exits */
+    elog_file_rotate_worker_stop();
+#endif
+
     elog_file_port_deinit();
 
     init_ok = false;
@@ -176,19 +840,23 @@ void elog_file_config(ElogFileCfg *cfg)
 {
     elog_file_port_lock();
 
-    if (fp) {
-        FCLOSE(fp);
-        fp = NULL;
-    }
+    elog_file_close();
 
     if (cfg != NULL) {
         local_cfg.name = cfg->name;
         local_cfg.max_size = cfg->max_size;
         local_cfg.max_rotate = cfg->max_rotate;
 
-        if (local_cfg.name != NULL && strlen(local_cfg.name) > 0)
-            fp = FOPEN(local_cfg.name, "a+");
+        if (local_cfg.name != NULL && strlen(local_cfg.name) > 0) {
+#ifdef ELOG_FILE_ROTATE_SEQ_ENABLE
+            /* continue to write the newest log file */
+            file_seq = elog_file_seq_find();
+            elog_file_seq_path(seq_path, sizeof(seq_path), file_seq);
+#endif
+            elog_file_open();
+        }
     }
+    file_size = elog_file_get_size();
 
     elog_file_port_unlock();
 }
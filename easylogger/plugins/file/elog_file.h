@@ -56,6 +56,8 @@ typedef struct {
 /* elog_file.c */
 ElogErrCode elog_file_init(void);
 void elog_file_write(const char *log, size_t size);
+void elog_file_write_vec(const ElogLogVec *vec, size_t num);
+void elog_file_flush(void);
 void elog_file_config(ElogFileCfg *cfg);
 void elog_file_deinit(void);
 
@@ -62,6 +62,49 @@
 #define ELOG_FILTER_TAG_LVL_MAX_NUM          4
 #endif
 
+#ifdef ELOG_FILTER_KW_SET_ENABLE
+/* output filter's keyword set max num */
+#ifndef ELOG_FILTER_KW_MAX_NUM
+#define ELOG_FILTER_KW_MAX_NUM               8
+#endif
+/* output filter's keyword set max different char num */
+#ifndef ELOG_FILTER_KW_CHAR_MAX_NUM
+#define ELOG_FILTER_KW_CHAR_MAX_NUM          32
+#endif
+/* keyword automaton max state num, every char of keywords and the root */
+#define KW_STATE_MAX_NUM                     (ELOG_FILTER_KW_MAX_NUM * ELOG_FILTER_KW_MAX_LEN + 1)
+#if ELOG_FILTER_KW_CHAR_MAX_NUM > 255
+    #error "The ELOG_FILTER_KW_CHAR_MAX_NUM must be less than 256"
+#endif
+#if KW_STATE_MAX_NUM > UINT16_MAX
+    #error "The ELOG_FILTER_KW_MAX_NUM * ELOG_FILTER_KW_MAX_LEN must be less than 65535"
+#endif
+/* keyword automaton state output, the include or exclude keyword is matched */
+#define KW_MATCH_INCLUDE                     (1 << 0)
+#define KW_MATCH_EXCLUDE                     (1 << 1)
+#endif /* ELOG_FILTER_KW_SET_ENABLE */
+
+#ifdef ELOG_THREAD_NAME_ENABLE
+/* thread name max length */
+#ifndef ELOG_THREAD_NAME_MAX_LEN
+#define ELOG_THREAD_NAME_MAX_LEN             16
+#endif
+#endif
+
+/* copy the string literal, its length is known at compile time */
+#define log_strcpy_literal(cur_len, dst, str) elog_strncpy(cur_len, dst, str, sizeof(str) - 1)
+
+/* log header format plan max step number, every format info and the literal before it, and the end step */
+#define FMT_PLAN_MAX_STEP                    18
+/* log header format plan literal buffer size */
+#define FMT_PLAN_LITERAL_SIZE                64
+
+#ifdef ELOG_TOKENIZE_ENABLE
+/* tokenized log frame sync byte and head length */
+#define ELOG_TOKEN_SYNC                      0xE7
+#define ELOG_TOKEN_HEAD_LEN                  7
+#endif
+
 #ifdef ELOG_COLOR_ENABLE
 /**
  * CSI(Control Sequence Introducer/Initiator) sign
@@ -116,8 +159,33 @@
 
 /* EasyLogger object */
 static EasyLogger elog;
+#ifdef ELOG_LINE_BUF_THREAD_LOCAL
+/* every line log's buffer, each thread has its own buffer */
+static ELOG_THREAD_LOCAL char log_buf[ELOG_LINE_BUF_SIZE] = { 0 };
+/* the line buffer is not shared, so the output lock is only required for output */
+#define log_buf_lock()
+#define log_buf_unlock()
+#if defined(ELOG_ASYNC_OUTPUT_ENABLE) && defined(ELOG_ASYNC_OUTPUT_LOCK_FREE)
+/* the lock free asynchronous output will lock the synchronous output by itself */
+#define log_buf_output_lock()
+#define log_buf_output_unlock()
+#else
+#define log_buf_output_lock()          elog_output_lock()
+#define log_buf_output_unlock()        elog_output_unlock()
+#endif
+#else
 /* every line log's buffer */
 static char log_buf[ELOG_LINE_BUF_SIZE] = { 0 };
+/* the line buffer is shared by all threads, so it must be locked when packaging log */
+#define log_buf_lock()                 elog_output_lock()
+#define log_buf_unlock()               elog_output_unlock()
+#define log_buf_output_lock()
+#define log_buf_output_unlock()
+#endif /* ELOG_LINE_BUF_THREAD_LOCAL */
+#ifdef ELOG_THREAD_NAME_ENABLE
+/* current thread name, it will replace the thread info of port when it is set */
+static ELOG_THREAD_LOCAL char thread_name[ELOG_THREAD_NAME_MAX_LEN + 1] = { 0 };
+#endif
 /* level output info */
 static const char *level_output_info[] = {
         [ELOG_LVL_ASSERT]  = "A/",
@@ -140,13 +208,126 @@ static const char *color_output_info[] = {
 };
 #endif /* ELOG_COLOR_ENABLE */
 
+/* log header format plan step type */
+typedef enum {
+    FMT_STEP_END = 0,                           /**< end of the plan */
+    FMT_STEP_LITERAL,                           /**< copy the literal, such as color, level and separator */
+    FMT_STEP_TAG,                               /**< tag and its space */
+    FMT_STEP_TIME,                              /**< time info */
+    FMT_STEP_P_INFO,                            /**< process info */
+    FMT_STEP_T_INFO,                            /**< thread info */
+    FMT_STEP_DIR,                               /**< file directory and name */
+    FMT_STEP_LINE,                              /**< line number */
+    FMT_STEP_FUNC,                              /**< function name */
+} FmtStepType;
+
+/* log header format plan step */
+typedef struct {
+    uint8_t type;
+    uint8_t offset;                             /**< literal offset in plan literal buffer */
+    uint8_t len;                                /**< literal length */
+} FmtStep;
+
+/* log header format plan, it is compiled from the format set and color status of every level */
+typedef struct {
+    FmtStep step[FMT_PLAN_MAX_STEP];
+    char literal[FMT_PLAN_LITERAL_SIZE];
+    uint8_t step_num;
+    uint8_t literal_len;
+} FmtPlan;
+
+/* log header format plan of every level */
+static FmtPlan fmt_plan[ELOG_LVL_TOTAL_NUM];
+
 static bool get_fmt_enabled(uint8_t level, size_t set);
+static void fmt_plan_compile(uint8_t level);
 static void elog_set_filter_tag_lvl_default(void);
 
 /* EasyLogger assert hook */
 void (*elog_assert_hook)(const char* expr, const char* func, size_t line);
 
+#if defined(__GNUC__)
+/* the tag level filter is read without lock, it is protected by sequence lock */
+#define FILTER_TAG_LVL_SEQLOCK
+/* tag level filter sequence, it is odd when the filter is being written */
+static uint32_t tag_lvl_seq = 0;
+/* keyword filter sequence, the keyword filter is read without lock when the line buffer is thread local */
+static uint32_t kw_seq = 0;
+/* format plan sequence, the format plan is read without lock when the line buffer is thread local or deferred */
+static uint32_t fmt_seq = 0;
+#define seq_write_begin(seq)                                                                        \
+    do {                                                                                            \
+        __atomic_store_n(&(seq), (seq) + 1, __ATOMIC_RELAXED);                                      \
+        __atomic_thread_fence(__ATOMIC_RELEASE);                                                    \
+    } while (0)
+#define seq_write_end(seq)             __atomic_store_n(&(seq), (seq) + 1, __ATOMIC_RELEASE)
+#define tag_lvl_write_begin()          seq_write_begin(tag_lvl_seq)
+#define tag_lvl_write_end()            seq_write_end(tag_lvl_seq)
+#define kw_write_begin()               seq_write_begin(kw_seq)
+#define kw_write_end()                 seq_write_end(kw_seq)
+#define fmt_write_begin()              seq_write_begin(fmt_seq)
+#define fmt_write_end()                seq_write_end(fmt_seq)
+#else
+#define tag_lvl_write_begin()
+#define tag_lvl_write_end()
+#define kw_write_begin()
+#define kw_write_end()
+#define fmt_write_begin()
+#define fmt_write_end()
+#endif /* defined(__GNUC__) */
+
+#ifdef ELOG_FILTER_KW_SET_ENABLE
+/* output filter's keyword set */
+typedef struct {
+    char keyword[ELOG_FILTER_KW_MAX_LEN + 1];
+    bool exclude;
+    bool used;
+} KwSetItem;
+
+/**
+ * Aho-Corasick automaton of the keyword set. The chars of keywords are mapped to char class (1 ~
+ * ELOG_FILTER_KW_CHAR_MAX_NUM, 0: not in any keyword), and the trie is converted to DFA, so every
+ * char of log only costs a table lookup no matter how many keywords are set.
+ */
+typedef struct {
+    uint8_t char_class[256];
+    uint8_t class_num;
+    uint16_t state_num;
+    uint16_t next[KW_STATE_MAX_NUM][ELOG_FILTER_KW_CHAR_MAX_NUM + 1];
+    uint8_t match[KW_STATE_MAX_NUM];
+    bool has_include;
+} KwAutomaton;
+
+static KwSetItem kw_set[ELOG_FILTER_KW_MAX_NUM];
+static KwAutomaton kw_automaton;
+#endif /* ELOG_FILTER_KW_SET_ENABLE */
+
+#ifdef ELOG_FILTER_CACHE_ENABLE
+/* filter generation, it will be increased after the filter is changed. the cache with 0 generation is not updated */
+volatile uint32_t elog_filter_gen = 1;
+#if defined(__GNUC__)
+/* the filter may be set by multiple threads without lock, the increment must not be lost */
+#define filter_gen_update()            __atomic_fetch_add(&elog_filter_gen, 1, __ATOMIC_RELEASE)
+#else
+#define filter_gen_update()            (elog_filter_gen++)
+#endif
+#else
+#define filter_gen_update()
+#endif
+
 extern void elog_port_output( char *log, size_t size);
+#ifdef ELOG_OUTPUT_FLUSH_LVL
+extern void elog_port_output_flush(void);
+/* flush the port output after the high level log is output */
+#define port_output_flush(level)                                                                    \
+    do {                                                                                            \
+        if ((level) <= ELOG_OUTPUT_FLUSH_LVL) {                                                     \
+            elog_port_output_flush();                                                               \
+        }                                                                                           \
+    } while (0)
+#else
+#define port_output_flush(level)
+#endif
 extern void elog_port_output_lock(void);
 extern void elog_port_output_unlock(void);
 
@@ -161,6 +342,7 @@ ElogErrCode elog_init(void) {
     extern int elog_port_loadconfig(void);
 
     ElogErrCode result = ELOG_NO_ERR;
+    uint8_t level;
 
     if (elog.init_ok == true) {
         return result;
@@ -185,6 +367,11 @@ ElogErrCode elog_init(void) {
     elog.output_is_locked_before_enable = false;
     elog.output_is_locked_before_disable = false;
 
+    /* compile the format plan of every level, the format may be set before initialize */
+    for (level = 0; level < ELOG_LVL_TOTAL_NUM; level++) {
+        fmt_plan_compile(level);
+    }
+
 #ifdef ELOG_COLOR_ENABLE
     /* disable text color by default */
     elog_set_text_color_enabled(false);
@@ -284,7 +471,13 @@ void elog_set_output_enabled(bool enabled) {
  * @param enabled TRUE: enable FALSE:disable
  */
 void elog_set_text_color_enabled(bool enabled) {
+    uint8_t level;
+
     elog.text_color_enabled = enabled;
+    /* the color info is a part of the format plan */
+    for (level = 0; level < ELOG_LVL_TOTAL_NUM; level++) {
+        fmt_plan_compile(level);
+    }
 }
 
 /**
@@ -316,6 +509,7 @@ void elog_set_fmt(uint8_t level, size_t set) {
     ELOG_ASSERT(level <= ELOG_LVL_VERBOSE);
 
     elog.enabled_fmt_set[level] = set;
+    fmt_plan_compile(level);
 }
 
 /**
@@ -342,6 +536,7 @@ void elog_set_filter_lvl(uint8_t level) {
     ELOG_ASSERT(level <= ELOG_LVL_VERBOSE);
 
     elog.filter.level = level;
+    filter_gen_update();
 }
 
 /**
@@ -351,15 +546,7 @@ void elog_set_filter_lvl(uint8_t level) {
  */
 void elog_set_filter_tag(const char *tag) {
     strncpy(elog.filter.tag, tag, ELOG_FILTER_TAG_MAX_LEN);
-}
-
-/**
- * set log filter's keyword
- *
- * @param keyword keyword
- */
-void elog_set_filter_kw(const char *keyword) {
-    strncpy(elog.filter.keyword, keyword, ELOG_FILTER_KW_MAX_LEN);
+    filter_gen_update();
 }
 
 /**
@@ -386,23 +573,293 @@ void elog_output_unlock(void) {
     }
 }
 
+/**
+ * set log filter's keyword
+ *
+ * @param keyword keyword
+ */
+void elog_set_filter_kw(const char *keyword) {
+    elog_output_lock();
+    kw_write_begin();
+    strncpy(elog.filter.keyword, keyword, ELOG_FILTER_KW_MAX_LEN);
+    kw_write_end();
+    elog_output_unlock();
+}
+
+#ifdef ELOG_FILTER_KW_SET_ENABLE
+/**
+ * build the keyword automaton by keyword set, the trie is built first, then it will be converted to DFA by
+ * breadth-first traversal with the failure links
+ *
+ * @param automaton keyword automaton
+ *
+ * @return false: the different char of keywords is more than ELOG_FILTER_KW_CHAR_MAX_NUM
+ */
+static bool kw_automaton_build(KwAutomaton *automaton) {
+    static uint16_t fail[KW_STATE_MAX_NUM], queue[KW_STATE_MAX_NUM];
+    size_t i, c, head = 0, tail = 0;
+    uint16_t state, child;
+    const char *kw;
+
+    memset(automaton, 0, sizeof(KwAutomaton));
+    automaton->state_num = 1;
+    /* build the trie, the state 0 is root, so the 0 next state means no child */
+    for (i = 0; i < ELOG_FILTER_KW_MAX_NUM; i++) {
+        if (!kw_set[i].used) {
+            continue;
+        }
+        for (state = 0, kw = kw_set[i].keyword; *kw != '\0'; kw++) {
+            if (!automaton->char_class[(uint8_t) *kw]) {
+                if (automaton->class_num >= ELOG_FILTER_KW_CHAR_MAX_NUM) {
+                    return false;
+                }
+                automaton->char_class[(uint8_t) *kw] = ++automaton->class_num;
+            }
+            c = automaton->char_class[(uint8_t) *kw];
+            if (!automaton->next[state][c]) {
+                automaton->next[state][c] = automaton->state_num++;
+            }
+            state = automaton->next[state][c];
+        }
+        automaton->match[state] |= kw_set[i].exclude ? KW_MATCH_EXCLUDE : KW_MATCH_INCLUDE;
+        automaton->has_include |= !kw_set[i].exclude;
+    }
+    /* the children of root fail to root */
+    for (c = 1; c <= automaton->class_num; c++) {
+        if ((child = automaton->next[0][c]) != 0) {
+            fail[child] = 0;
+            queue[tail++] = child;
+        }
+    }
+    /* the missing next state is the next state of failure state, so matching never goes back */
+    while (head < tail) {
+        state = queue[head++];
+        for (c = 1; c <= automaton->class_num; c++) {
+            child = automaton->next[state][c];
+            if (child) {
+                fail[child] = automaton->next[fail[state]][c];
+                automaton->match[child] |= automaton->match[fail[child]];
+                queue[tail++] = child;
+            } else {
+                automaton->next[state][c] = automaton->next[fail[state]][c];
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * add a keyword to the output filter's keyword set.
+ * The log will be output only when it has one of include keywords (if any), and has none of exclude keywords.
+ *
+ * @param keyword keyword
+ * @param exclude true: exclude keyword, false: include keyword
+ *
+ * @return false: the keyword set is full or there are too many different chars in keywords
+ */
+bool elog_add_filter_kw(const char *keyword, bool exclude) {
+    size_t i, empty = ELOG_FILTER_KW_MAX_NUM;
+    bool result = true;
+
+    ELOG_ASSERT(keyword);
+
+    if (keyword[0] == '\0') {
+        return false;
+    }
+
+    elog_output_lock();
+    for (i = 0; i < ELOG_FILTER_KW_MAX_NUM; i++) {
+        if (!kw_set[i].used) {
+            empty = empty < i ? empty : i;
+        } else if (!strncmp(kw_set[i].keyword, keyword, ELOG_FILTER_KW_MAX_LEN)) {
+            break;
+        }
+    }
+    if (i == ELOG_FILTER_KW_MAX_NUM) {
+        /* add new keyword */
+        if (empty == ELOG_FILTER_KW_MAX_NUM) {
+            result = false;
+        } else {
+            i = empty;
+            strncpy(kw_set[i].keyword, keyword, ELOG_FILTER_KW_MAX_LEN);
+            kw_set[i].used = true;
+        }
+    }
+    if (result) {
+        kw_set[i].exclude = exclude;
+        kw_write_begin();
+        if (!kw_automaton_build(&kw_automaton)) {
+            /* remove the new keyword which has too many different chars */
+            memset(&kw_set[i], 0, sizeof(KwSetItem));
+            kw_automaton_build(&kw_automaton);
+            result = false;
+        }
+        kw_write_end();
+    }
+    elog_output_unlock();
+
+    return result;
+}
+
+/**
+ * delete the keyword from the output filter's keyword set
+ *
+ * @param keyword keyword
+ */
+void elog_del_filter_kw(const char *keyword) {
+    size_t i;
+
+    ELOG_ASSERT(keyword);
+
+    elog_output_lock();
+    for (i = 0; i < ELOG_FILTER_KW_MAX_NUM; i++) {
+        if (kw_set[i].used && !strncmp(kw_set[i].keyword, keyword, ELOG_FILTER_KW_MAX_LEN)) {
+            memset(&kw_set[i], 0, sizeof(KwSetItem));
+            kw_write_begin();
+            kw_automaton_build(&kw_automaton);
+            kw_write_end();
+            break;
+        }
+    }
+    elog_output_unlock();
+}
+
+/**
+ * clear the output filter's keyword set
+ */
+void elog_clear_filter_kw(void) {
+    elog_output_lock();
+    memset(kw_set, 0, sizeof(kw_set));
+    kw_write_begin();
+    kw_automaton_build(&kw_automaton);
+    kw_write_end();
+    elog_output_unlock();
+}
+
+/**
+ * match the log with the keyword set in a single pass
+ *
+ * @param log log
+ * @param len log length
+ *
+ * @return true: the log will be output, false: the log is filtered
+ */
+static bool kw_set_match(const char *log, size_t len) {
+    const KwAutomaton *automaton = &kw_automaton;
+    uint16_t state = 0;
+    uint8_t match = 0;
+    size_t i;
+
+    if (automaton->state_num <= 1) {
+        return true;
+    }
+    for (i = 0; i < len; i++) {
+        state = automaton->next[state][automaton->char_class[(uint8_t) log[i]]];
+        match |= automaton->match[state];
+        if (match & KW_MATCH_EXCLUDE) {
+            return false;
+        }
+    }
+
+    return !automaton->has_include || (match & KW_MATCH_INCLUDE);
+}
+#endif /* ELOG_FILTER_KW_SET_ENABLE */
+
+/**
+ * calculate the tag level filter hash table index of the tag, only the first ELOG_FILTER_TAG_MAX_LEN chars are used
+ *
+ * @param tag tag
+ *
+ * @return hash table index
+ */
+static size_t filter_tag_lvl_hash(const char *tag) {
+    /* FNV-1a hash */
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < ELOG_FILTER_TAG_MAX_LEN && tag[i] != '\0'; i++) {
+        hash ^= (uint8_t) tag[i];
+        hash *= 16777619u;
+    }
+
+    return hash % ELOG_FILTER_TAG_LVL_TABLE_SIZE;
+}
+
+/**
+ * find the tag in tag level filter hash table by linear probing
+ *
+ * @param tag tag
+ * @param found true: the tag is found, false: the tag is not found, return the empty slot for it
+ *
+ * @return hash table index, ELOG_FILTER_TAG_LVL_TABLE_SIZE: the empty slot is not found
+ */
+static size_t filter_tag_lvl_find(const char *tag, bool *found) {
+    size_t i, index = filter_tag_lvl_hash(tag);
+
+    *found = false;
+    for (i = 0; i < ELOG_FILTER_TAG_LVL_TABLE_SIZE; i++) {
+        if (!elog.filter.tag_lvl[index].tag_use_flag) {
+            return index;
+        } else if (!strncmp(tag, elog.filter.tag_lvl[index].tag, ELOG_FILTER_TAG_MAX_LEN)) {
+            *found = true;
+            return index;
+        }
+        index = (index + 1) % ELOG_FILTER_TAG_LVL_TABLE_SIZE;
+    }
+
+    return ELOG_FILTER_TAG_LVL_TABLE_SIZE;
+}
+
+/**
+ * remove the tag from tag level filter hash table, the following entries will be moved back to keep the probe
+ * sequence without tombstone
+ *
+ * @param index hash table index of removed tag
+ */
+static void filter_tag_lvl_remove(size_t index) {
+    ElogTagLvlFilter *tag_lvl = elog.filter.tag_lvl;
+    size_t next = index, home;
+
+    while (true) {
+        next = (next + 1) % ELOG_FILTER_TAG_LVL_TABLE_SIZE;
+        if (!tag_lvl[next].tag_use_flag) {
+            break;
+        }
+        home = filter_tag_lvl_hash(tag_lvl[next].tag);
+        /* move it to the empty slot when its home is not between the empty slot and it */
+        if ((next > index && (home <= index || home > next)) || (next < index && home <= index && home > next)) {
+            tag_lvl[index] = tag_lvl[next];
+            index = next;
+        }
+    }
+    memset(&tag_lvl[index], 0, sizeof(ElogTagLvlFilter));
+    tag_lvl[index].level = ELOG_FILTER_LVL_SILENT;
+    elog.filter.tag_lvl_num--;
+}
+
 /**
  * set log filter's tag level val to default
  */
 static void elog_set_filter_tag_lvl_default()
 {
-    uint8_t i = 0;
+    size_t i = 0;
 
-    for (i =0; i< ELOG_FILTER_TAG_LVL_MAX_NUM; i++){
+    tag_lvl_write_begin();
+    for (i = 0; i < ELOG_FILTER_TAG_LVL_TABLE_SIZE; i++) {
         memset(elog.filter.tag_lvl[i].tag, '\0', ELOG_FILTER_TAG_MAX_LEN + 1);
         elog.filter.tag_lvl[i].level = ELOG_FILTER_LVL_SILENT;
         elog.filter.tag_lvl[i].tag_use_flag = false;
     }
+    elog.filter.tag_lvl_num = 0;
+    tag_lvl_write_end();
+    filter_gen_update();
 }
 
 /**
  * Set the filter's level by different tag.
  * The log on this tag which level is less than it will stop output.
+ * The new tag can't be added when there are already ELOG_FILTER_TAG_LVL_MAX_NUM tags.
  *
  * example:
  *     // the example tag log enter silent mode
@@ -417,50 +874,46 @@ static void elog_set_filter_tag_lvl_default()
  *        When the level is ELOG_FILTER_LVL_ALL, it will remove this tag's level filer.
  *        Then all level log will resume output.
  *
+ * @return false: the new tag can't be added because the tag level filter is full
  */
-void elog_set_filter_tag_lvl(const char *tag, uint8_t level)
+bool elog_set_filter_tag_lvl(const char *tag, uint8_t level)
 {
     ELOG_ASSERT(level <= ELOG_LVL_VERBOSE);
     ELOG_ASSERT(tag != ((void *)0));
-    uint8_t i = 0;
+    size_t index;
+    bool found, result = true;
 
     if (!elog.init_ok) {
-        return;
+        return false;
     }
 
     elog_output_lock();
-    /* find the tag in arr */
-    for (i =0; i< ELOG_FILTER_TAG_LVL_MAX_NUM; i++){
-        if (elog.filter.tag_lvl[i].tag_use_flag == true &&
-            !strncmp(tag, elog.filter.tag_lvl[i].tag,ELOG_FILTER_TAG_MAX_LEN)){
-            break;
-        }
-    }
-
-    if (i < ELOG_FILTER_TAG_LVL_MAX_NUM){
-        /* find OK */
-        if (level == ELOG_FILTER_LVL_ALL){
+    /* find the tag in hash table */
+    index = filter_tag_lvl_find(tag, &found);
+    tag_lvl_write_begin();
+    if (found) {
+        if (level == ELOG_FILTER_LVL_ALL) {
             /* remove current tag's level filter when input level is the lowest level */
-             elog.filter.tag_lvl[i].tag_use_flag = false;
-             memset(elog.filter.tag_lvl[i].tag, '\0', ELOG_FILTER_TAG_MAX_LEN + 1);
-             elog.filter.tag_lvl[i].level = ELOG_FILTER_LVL_SILENT;
-        } else{
-            elog.filter.tag_lvl[i].level = level;
+            filter_tag_lvl_remove(index);
+        } else {
+            elog.filter.tag_lvl[index].level = level;
         }
-    } else{
+    } else if (level != ELOG_FILTER_LVL_ALL && elog.filter.tag_lvl_num < ELOG_FILTER_TAG_LVL_MAX_NUM
+            && index < ELOG_FILTER_TAG_LVL_TABLE_SIZE) {
         /* only add the new tag's level filer when level is not ELOG_FILTER_LVL_ALL */
-        if (level != ELOG_FILTER_LVL_ALL){
-            for (i =0; i< ELOG_FILTER_TAG_LVL_MAX_NUM; i++){
-                if (elog.filter.tag_lvl[i].tag_use_flag == false){
-                    strncpy(elog.filter.tag_lvl[i].tag, tag, ELOG_FILTER_TAG_MAX_LEN);
-                    elog.filter.tag_lvl[i].level = level;
-                    elog.filter.tag_lvl[i].tag_use_flag = true;
-                    break;
-                }
-            }
-        }
+        strncpy(elog.filter.tag_lvl[index].tag, tag, ELOG_FILTER_TAG_MAX_LEN);
+        elog.filter.tag_lvl[index].level = level;
+        elog.filter.tag_lvl[index].tag_use_flag = true;
+        elog.filter.tag_lvl_num++;
+    } else if (level != ELOG_FILTER_LVL_ALL) {
+        /* please increase ELOG_FILTER_TAG_LVL_MAX_NUM */
+        result = false;
     }
+    tag_lvl_write_end();
+    filter_gen_update();
     elog_output_unlock();
+
+    return result;
 }
 
 /**
@@ -474,27 +927,78 @@ void elog_set_filter_tag_lvl(const char *tag, uint8_t level)
 uint8_t elog_get_filter_tag_lvl(const char *tag)
 {
     ELOG_ASSERT(tag != ((void *)0));
-    uint8_t i = 0;
     uint8_t level = ELOG_FILTER_LVL_ALL;
+    size_t index;
+    bool found;
 
     if (!elog.init_ok) {
         return level;
     }
 
+#ifdef FILTER_TAG_LVL_SEQLOCK
+    uint32_t seq;
+    /* read again when the filter is being written */
+    do {
+        seq = __atomic_load_n(&tag_lvl_seq, __ATOMIC_ACQUIRE);
+        index = filter_tag_lvl_find(tag, &found);
+        level = found ? elog.filter.tag_lvl[index].level : ELOG_FILTER_LVL_ALL;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&tag_lvl_seq, __ATOMIC_RELAXED));
+#else
     elog_output_lock();
-    /* find the tag in arr */
-    for (i =0; i< ELOG_FILTER_TAG_LVL_MAX_NUM; i++){
-        if (elog.filter.tag_lvl[i].tag_use_flag == true &&
-            !strncmp(tag, elog.filter.tag_lvl[i].tag,ELOG_FILTER_TAG_MAX_LEN)){
-            level = elog.filter.tag_lvl[i].level;
-            break;
-        }
+    /* find the tag in hash table */
+    index = filter_tag_lvl_find(tag, &found);
+    if (found) {
+        level = elog.filter.tag_lvl[index].level;
     }
     elog_output_unlock();
+#endif /* FILTER_TAG_LVL_SEQLOCK */
 
     return level;
 }
 
+#ifdef ELOG_FILTER_CACHE_ENABLE
+/**
+ * update the filter cache of log call site, it will be called by the log output macro when the
+ * filter is changed after the cache was updated
+ *
+ * @param cache filter cache of log call site
+ * @param level level
+ * @param tag tag
+ *
+ * @return true: the log is enabled, false: the log is filtered
+ */
+bool elog_filter_cache_update(ElogFilterCache *cache, uint8_t level, const char *tag) {
+    /* the generation must be got before the filter, so the cache will be updated again when filter is changing */
+    uint32_t gen = elog_filter_gen_load();
+    const char *cache_tag = NULL;
+    bool enabled = true;
+
+    if (level > elog.filter.level || level > elog_get_filter_tag_lvl(tag)) {
+        enabled = false;
+    } else if (!strstr(tag, elog.filter.tag)) {
+        enabled = false;
+    }
+    /* the cache is bound to the first tag, so its state is only written by the log with this tag */
+#if defined(__GNUC__)
+    if (cache->tag_addr == tag || (cache->tag_addr == NULL && __atomic_compare_exchange_n(&cache->tag_addr,
+            &cache_tag, tag, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))) {
+        __atomic_store_n(&cache->state, (gen << 1) | enabled, __ATOMIC_RELAXED);
+    }
+#else
+    (void) cache_tag;
+    if (cache->tag_addr == NULL) {
+        cache->tag_addr = tag;
+    }
+    if (cache->tag_addr == tag) {
+        cache->state = (gen << 1) | enabled;
+    }
+#endif
+
+    return enabled;
+}
+#endif /* ELOG_FILTER_CACHE_ENABLE */
+
 /**
  * output RAW format log
  *
@@ -514,8 +1018,8 @@ void elog_raw(const char *format, ...) {
     /* args point to the first variable parameter */
     va_start(args, format);
 
-    /* lock output */
-    elog_output_lock();
+    /* lock line buffer */
+    log_buf_lock();
 
     /* package log data to buffer */
     fmt_result = vsnprintf(log_buf, ELOG_LINE_BUF_SIZE, format, args);
@@ -526,6 +1030,8 @@ void elog_raw(const char *format, ...) {
     } else {
         log_len = ELOG_LINE_BUF_SIZE;
     }
+    /* lock output */
+    log_buf_output_lock();
     /* output log */
 #if defined(ELOG_ASYNC_OUTPUT_ENABLE)
     extern void elog_async_output(uint8_t level, const char *log, size_t size);
@@ -538,128 +1044,225 @@ void elog_raw(const char *format, ...) {
     elog_port_output(log_buf, log_len);
 #endif
     /* unlock output */
-    elog_output_unlock();
+    log_buf_output_unlock();
+    /* unlock line buffer */
+    log_buf_unlock();
 
     va_end(args);
 }
 
 /**
- * output the log
+ * get current thread info, the thread name will be used when it is set
+ *
+ * @return thread info
+ */
+static const char *log_get_t_info(void) {
+    extern const char *elog_port_get_t_info(void);
+
+#ifdef ELOG_THREAD_NAME_ENABLE
+    if (thread_name[0] != '\0') {
+        return thread_name;
+    }
+#endif
+
+    return elog_port_get_t_info();
+}
+
+#ifdef ELOG_THREAD_NAME_ENABLE
+/**
+ * set current thread name, it will be output as the thread info
+ *
+ * @param name thread name, NULL or "": using the thread info of port
+ */
+void elog_set_thread_name(const char *name) {
+    if (name) {
+        strncpy(thread_name, name, ELOG_THREAD_NAME_MAX_LEN);
+        thread_name[ELOG_THREAD_NAME_MAX_LEN] = '\0';
+    } else {
+        thread_name[0] = '\0';
+    }
+}
+
+/**
+ * get current thread name
  *
+ * @return thread name, "": it is not set
+ */
+const char *elog_get_thread_name(void) {
+    return thread_name;
+}
+#endif /* ELOG_THREAD_NAME_ENABLE */
+
+/**
+ * load the log header format plan of the level. The thread local line buffer and the deferred format log are
+ * packaged without output lock, so the plan is copied by sequence lock (or output lock) while it may be changed.
+ *
+ * @param level level
+ * @param plan the copied format plan
+ */
+static void fmt_plan_load(uint8_t level, FmtPlan *plan) {
+#ifdef FILTER_TAG_LVL_SEQLOCK
+    uint32_t seq;
+
+    /* copy again when the format plan is being written */
+    do {
+        seq = __atomic_load_n(&fmt_seq, __ATOMIC_ACQUIRE);
+        memcpy(plan, &fmt_plan[level], sizeof(FmtPlan));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&fmt_seq, __ATOMIC_RELAXED));
+#elif defined(ELOG_LINE_BUF_THREAD_LOCAL)
+    elog_output_lock();
+    memcpy(plan, &fmt_plan[level], sizeof(FmtPlan));
+    elog_output_unlock();
+#else
+    /* the shared line buffer is packaged in output lock */
+    memcpy(plan, &fmt_plan[level], sizeof(FmtPlan));
+#endif
+}
+
+/**
+ * package the log header to line buffer
+ *
+ * @param log_buf line buffer, its size is ELOG_LINE_BUF_SIZE
  * @param level level
  * @param tag tag
  * @param file file name
  * @param func function name
  * @param line line number
- * @param format output format
- * @param ... args
+ * @param time time info, NULL: get it from port
+ * @param p_info process info, NULL: get it from port
+ * @param t_info thread info, NULL: get it from port
  *
+ * @return packaged header length
  */
-void elog_output(uint8_t level, const char *tag, const char *file, const char *func,
-        const long line, const char *format, ...) {
+static size_t log_package_header(char *log_buf, uint8_t level, const char *tag, const char *file,
+        const char *func, const long line, const char *time, const char *p_info, const char *t_info) {
     extern const char *elog_port_get_time(void);
     extern const char *elog_port_get_p_info(void);
-    extern const char *elog_port_get_t_info(void);
 
-    size_t tag_len = strlen(tag), log_len = 0, newline_len = strlen(ELOG_NEWLINE_SIGN);
+    FmtPlan plan;
+    const FmtStep *step;
+    size_t tag_len, space_len, log_len = 0;
+    int line_len;
     char line_num[ELOG_LINE_NUM_MAX_LEN + 1] = { 0 };
-    char tag_sapce[ELOG_FILTER_TAG_MAX_LEN / 2 + 1] = { 0 };
-    va_list args;
-    int fmt_result;
-
-    ELOG_ASSERT(level <= ELOG_LVL_VERBOSE);
 
-    /* check output enabled */
-    if (!elog.output_enabled) {
-        return;
-    }
-    /* level filter */
-    if (level > elog.filter.level || level > elog_get_filter_tag_lvl(tag)) {
-        return;
-    } else if (!strstr(tag, elog.filter.tag)) { /* tag filter */
-        return;
+    /* only execute the format plan which is compiled by elog_set_fmt */
+    fmt_plan_load(level, &plan);
+    for (step = plan.step; step->type != FMT_STEP_END; step++) {
+        switch (step->type) {
+        case FMT_STEP_LITERAL:
+            log_len += elog_strncpy(log_len, log_buf + log_len, plan.literal + step->offset, step->len);
+            break;
+        case FMT_STEP_TAG:
+            tag_len = strlen(tag);
+            log_len += elog_strncpy(log_len, log_buf + log_len, tag, tag_len);
+            /* if the tag length is less than 50% ELOG_FILTER_TAG_MAX_LEN, then fill space, and a space after tag */
+            space_len = (tag_len <= ELOG_FILTER_TAG_MAX_LEN / 2 ? ELOG_FILTER_TAG_MAX_LEN / 2 - tag_len : 0) + 1;
+            if (log_len + space_len <= ELOG_LINE_BUF_SIZE) {
+                memset(log_buf + log_len, ' ', space_len);
+                log_len += space_len;
+            }
+            break;
+        case FMT_STEP_TIME:
+            log_len += elog_strcpy(log_len, log_buf + log_len, time ? time : elog_port_get_time());
+            break;
+        case FMT_STEP_P_INFO:
+            log_len += elog_strcpy(log_len, log_buf + log_len, p_info ? p_info : elog_port_get_p_info());
+            break;
+        case FMT_STEP_T_INFO:
+            log_len += elog_strcpy(log_len, log_buf + log_len, t_info ? t_info : log_get_t_info());
+            break;
+        case FMT_STEP_DIR:
+            log_len += elog_strcpy(log_len, log_buf + log_len, file);
+            break;
+        case FMT_STEP_LINE:
+            line_len = snprintf(line_num, ELOG_LINE_NUM_MAX_LEN, "%ld", line);
+            /* the line number will be truncated when it is longer than ELOG_LINE_NUM_MAX_LEN - 1 */
+            if (line_len > 0) {
+                log_len += elog_strncpy(log_len, log_buf + log_len, line_num,
+                        line_len < ELOG_LINE_NUM_MAX_LEN ? line_len : ELOG_LINE_NUM_MAX_LEN - 1);
+            }
+            break;
+        case FMT_STEP_FUNC:
+            log_len += elog_strcpy(log_len, log_buf + log_len, func);
+            break;
+        }
     }
-    /* args point to the first variable parameter */
-    va_start(args, format);
-    /* lock output */
-    elog_output_lock();
 
-#ifdef ELOG_COLOR_ENABLE
-    /* add CSI start sign and color info */
-    if (elog.text_color_enabled) {
-        log_len += elog_strcpy(log_len, log_buf + log_len, CSI_START);
-        log_len += elog_strcpy(log_len, log_buf + log_len, color_output_info[level]);
-    }
-#endif
+    return log_len;
+}
 
-    /* package level info */
-    if (get_fmt_enabled(level, ELOG_FMT_LVL)) {
-        log_len += elog_strcpy(log_len, log_buf + log_len, level_output_info[level]);
-    }
-    /* package tag info */
-    if (get_fmt_enabled(level, ELOG_FMT_TAG)) {
-        log_len += elog_strcpy(log_len, log_buf + log_len, tag);
-        /* if the tag length is less than 50% ELOG_FILTER_TAG_MAX_LEN, then fill space */
-        if (tag_len <= ELOG_FILTER_TAG_MAX_LEN / 2) {
-            memset(tag_sapce, ' ', ELOG_FILTER_TAG_MAX_LEN / 2 - tag_len);
-            log_len += elog_strcpy(log_len, log_buf + log_len, tag_sapce);
-        }
-        log_len += elog_strcpy(log_len, log_buf + log_len, " ");
-    }
-    /* package time, process and thread info */
-    if (get_fmt_enabled(level, ELOG_FMT_TIME | ELOG_FMT_P_INFO | ELOG_FMT_T_INFO)) {
-        log_len += elog_strcpy(log_len, log_buf + log_len, "[");
-        /* package time info */
-        if (get_fmt_enabled(level, ELOG_FMT_TIME)) {
-            log_len += elog_strcpy(log_len, log_buf + log_len, elog_port_get_time());
-            if (get_fmt_enabled(level, ELOG_FMT_P_INFO | ELOG_FMT_T_INFO)) {
-                log_len += elog_strcpy(log_len, log_buf + log_len, " ");
-            }
-        }
-        /* package process info */
-        if (get_fmt_enabled(level, ELOG_FMT_P_INFO)) {
-            log_len += elog_strcpy(log_len, log_buf + log_len, elog_port_get_p_info());
-            if (get_fmt_enabled(level, ELOG_FMT_T_INFO)) {
-                log_len += elog_strcpy(log_len, log_buf + log_len, " ");
-            }
-        }
-        /* package thread info */
-        if (get_fmt_enabled(level, ELOG_FMT_T_INFO)) {
-            log_len += elog_strcpy(log_len, log_buf + log_len, elog_port_get_t_info());
+/**
+ * match the log with the keyword filter and keyword set filter
+ *
+ * @param log_buf log buffer
+ * @param log_len log length
+ *
+ * @return true: the log will be output, false: the log is filtered
+ */
+static bool filter_kw_match_nolock(char *log_buf, size_t log_len) {
+    if (elog.filter.keyword[0] != '\0') {
+        /* add string end sign */
+        log_buf[log_len] = '\0';
+        /* find the keyword */
+        if (!strstr(log_buf, elog.filter.keyword)) {
+            return false;
         }
-        log_len += elog_strcpy(log_len, log_buf + log_len, "] ");
     }
-    /* package file directory and name, function name and line number info */
-    if (get_fmt_enabled(level, ELOG_FMT_DIR | ELOG_FMT_FUNC | ELOG_FMT_LINE)) {
-        log_len += elog_strcpy(log_len, log_buf + log_len, "(");
-        /* package file info */
-        if (get_fmt_enabled(level, ELOG_FMT_DIR)) {
-            log_len += elog_strcpy(log_len, log_buf + log_len, file);
-            if (get_fmt_enabled(level, ELOG_FMT_FUNC)) {
-                log_len += elog_strcpy(log_len, log_buf + log_len, ":");
-            } else if (get_fmt_enabled(level, ELOG_FMT_LINE)) {
-                log_len += elog_strcpy(log_len, log_buf + log_len, " ");
-            }
-        }
-        /* package line info */
-        if (get_fmt_enabled(level, ELOG_FMT_LINE)) {
-            snprintf(line_num, ELOG_LINE_NUM_MAX_LEN, "%ld", line);
-            log_len += elog_strcpy(log_len, log_buf + log_len, line_num);
-            if (get_fmt_enabled(level, ELOG_FMT_FUNC)) {
-                log_len += elog_strcpy(log_len, log_buf + log_len, " ");
-            }
-        }
-        /* package func info */
-        if (get_fmt_enabled(level, ELOG_FMT_FUNC)) {
-            log_len += elog_strcpy(log_len, log_buf + log_len, func);
-            
-        }
-        log_len += elog_strcpy(log_len, log_buf + log_len, ")");
+#ifdef ELOG_FILTER_KW_SET_ENABLE
+    /* keyword set filter */
+    if (!kw_set_match(log_buf, log_len)) {
+        return false;
     }
-    /* package other log data to buffer. '\0' must be added in the end by vsnprintf. */
-    fmt_result = vsnprintf(log_buf + log_len, ELOG_LINE_BUF_SIZE - log_len, format, args);
+#endif
+
+    return true;
+}
+
+/**
+ * match the log with the keyword filters. The thread local line buffer is packaged without output lock,
+ * so the keyword filters are read by sequence lock (or output lock) while they may be changed.
+ *
+ * @param log_buf log buffer
+ * @param log_len log length
+ *
+ * @return true: the log will be output, false: the log is filtered
+ */
+static bool filter_kw_match(char *log_buf, size_t log_len) {
+    bool result;
+#if defined(ELOG_LINE_BUF_THREAD_LOCAL) && defined(FILTER_TAG_LVL_SEQLOCK)
+    uint32_t seq;
+
+    /* match again when the keyword filters are being written */
+    do {
+        seq = __atomic_load_n(&kw_seq, __ATOMIC_ACQUIRE);
+        result = filter_kw_match_nolock(log_buf, log_len);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&kw_seq, __ATOMIC_RELAXED));
+#elif defined(ELOG_LINE_BUF_THREAD_LOCAL)
+    elog_output_lock();
+    result = filter_kw_match_nolock(log_buf, log_len);
+    elog_output_unlock();
+#else
+    /* the shared line buffer is packaged in output lock */
+    result = filter_kw_match_nolock(log_buf, log_len);
+#endif
+
+    return result;
+}
+
+/**
+ * package the log end (CSI end sign and newline sign) to line buffer, the keyword filter will be done
+ *
+ * @param log_buf line buffer, its size is ELOG_LINE_BUF_SIZE
+ * @param log_len packaged header length
+ * @param fmt_result the format result for log data
+ *
+ * @return log length, 0: the log is filtered by keyword
+ */
+static size_t log_package_end(char *log_buf, size_t log_len, int fmt_result) {
+    size_t newline_len = sizeof(ELOG_NEWLINE_SIGN) - 1;
 
-    va_end(args);
     /* calculate log length */
     if ((log_len + fmt_result <= ELOG_LINE_BUF_SIZE) && (fmt_result > -1)) {
         log_len += fmt_result;
@@ -683,26 +1286,223 @@ void elog_output(uint8_t level, const char *tag, const char *file, const char *f
         log_len -= newline_len;
     }
     /* keyword filter */
-    if (elog.filter.keyword[0] != '\0') {
-        /* add string end sign */
-        log_buf[log_len] = '\0';
-        /* find the keyword */
-        if (!strstr(log_buf, elog.filter.keyword)) {
-            /* unlock output */
-            elog_output_unlock();
-            return;
-        }
+    if (!filter_kw_match(log_buf, log_len)) {
+        return 0;
     }
 
 #ifdef ELOG_COLOR_ENABLE
     /* add CSI end sign */
     if (elog.text_color_enabled) {
-        log_len += elog_strcpy(log_len, log_buf + log_len, CSI_END);
+        log_len += log_strcpy_literal(log_len, log_buf + log_len, CSI_END);
     }
 #endif
 
     /* package newline sign */
-    log_len += elog_strcpy(log_len, log_buf + log_len, ELOG_NEWLINE_SIGN);
+    log_len += log_strcpy_literal(log_len, log_buf + log_len, ELOG_NEWLINE_SIGN);
+
+    return log_len;
+}
+
+#ifdef ELOG_ASYNC_DEFERRED_FORMAT
+/* the deferred format log's header, it is followed by tag, time, process and thread info and packed arguments */
+typedef struct {
+    const char *format;
+    const char *file;
+    const char *func;
+    long line;
+    uint8_t level;
+    uint8_t tag_len;
+    uint8_t time_len;
+    uint8_t p_info_len;
+    uint8_t t_info_len;
+#ifdef ELOG_TIMESTAMP_ENABLE
+    /* the raw timestamp, it will be converted to time string when formatting */
+    uint64_t timestamp;
+#endif
+} ElogDeferredLog;
+
+/**
+ * put the string to deferred format log, the too long string will be cut
+ *
+ * @param log_buf line buffer, its size is ELOG_LINE_BUF_SIZE
+ * @param log_len current log length
+ * @param str string
+ * @param len string length in deferred format log
+ *
+ * @return current log length
+ */
+static size_t log_deferred_put_str(char *log_buf, size_t log_len, const char *str, uint8_t *len) {
+    size_t str_len = strlen(str);
+
+    if (str_len > UINT8_MAX) {
+        str_len = UINT8_MAX;
+    }
+    str_len = elog_strncpy(log_len, log_buf + log_len, str, str_len);
+    *len = (uint8_t) str_len;
+
+    return log_len + str_len;
+}
+
+/**
+ * Package the deferred format log, it only has the format, arguments and log context info.
+ * The log will be formatted by @see elog_deferred_format on asynchronous output thread.
+ *
+ * @param log_buf line buffer, its size is ELOG_LINE_BUF_SIZE
+ * @param level level
+ * @param tag tag
+ * @param file file name
+ * @param func function name
+ * @param line line number
+ * @param format output format
+ * @param args arguments
+ *
+ * @return deferred format log length, 0: the format is not supported
+ */
+static size_t log_package_deferred(char *log_buf, uint8_t level, const char *tag, const char *file,
+        const char *func, const long line, const char *format, va_list args) {
+    extern const char *elog_port_get_time(void);
+    extern const char *elog_port_get_p_info(void);
+
+    ElogDeferredLog deferred = { .format = format, .file = file, .func = func, .line = line, .level = level };
+    size_t log_len = sizeof(ElogDeferredLog), args_len;
+
+    log_len = log_deferred_put_str(log_buf, log_len, tag, &deferred.tag_len);
+    if (get_fmt_enabled(level, ELOG_FMT_TIME)) {
+#ifdef ELOG_TIMESTAMP_ENABLE
+        extern uint64_t elog_port_get_timestamp(void);
+        deferred.timestamp = elog_port_get_timestamp();
+#else
+        log_len = log_deferred_put_str(log_buf, log_len, elog_port_get_time(), &deferred.time_len);
+#endif
+    }
+    if (get_fmt_enabled(level, ELOG_FMT_P_INFO)) {
+        log_len = log_deferred_put_str(log_buf, log_len, elog_port_get_p_info(), &deferred.p_info_len);
+    }
+    if (get_fmt_enabled(level, ELOG_FMT_T_INFO)) {
+        log_len = log_deferred_put_str(log_buf, log_len, log_get_t_info(), &deferred.t_info_len);
+    }
+    args_len = elog_args_pack(log_buf + log_len, ELOG_LINE_BUF_SIZE - log_len, format, args);
+    if (!args_len) {
+        return 0;
+    }
+    memcpy(log_buf, &deferred, sizeof(ElogDeferredLog));
+
+    return log_len + args_len;
+}
+
+/**
+ * format the deferred format log which is packaged by @see log_package_deferred
+ *
+ * @param log_buf line buffer, its size is ELOG_LINE_BUF_SIZE
+ * @param log deferred format log
+ *
+ * @return log length, 0: the log is filtered by keyword
+ */
+size_t elog_deferred_format(char *log_buf, const char *log) {
+    ElogDeferredLog deferred;
+    char tag[UINT8_MAX + 1], time[UINT8_MAX + 1], p_info[UINT8_MAX + 1], t_info[UINT8_MAX + 1];
+    size_t log_len;
+    int fmt_result;
+
+    memcpy(&deferred, log, sizeof(ElogDeferredLog));
+    log += sizeof(ElogDeferredLog);
+    memcpy(tag, log, deferred.tag_len);
+    tag[deferred.tag_len] = '\0';
+    log += deferred.tag_len;
+    memcpy(time, log, deferred.time_len);
+    time[deferred.time_len] = '\0';
+    log += deferred.time_len;
+#ifdef ELOG_TIMESTAMP_ENABLE
+    if (get_fmt_enabled(deferred.level, ELOG_FMT_TIME)) {
+        extern const char *elog_port_timestamp_to_time(uint64_t timestamp);
+        /* convert the timestamp to time string on asynchronous output thread */
+        strncpy(time, elog_port_timestamp_to_time(deferred.timestamp), UINT8_MAX);
+        time[UINT8_MAX] = '\0';
+    }
+#endif
+    memcpy(p_info, log, deferred.p_info_len);
+    p_info[deferred.p_info_len] = '\0';
+    log += deferred.p_info_len;
+    memcpy(t_info, log, deferred.t_info_len);
+    t_info[deferred.t_info_len] = '\0';
+    log += deferred.t_info_len;
+
+    log_len = log_package_header(log_buf, deferred.level, tag, deferred.file, deferred.func, deferred.line,
+            time, p_info, t_info);
+    fmt_result = elog_args_snprintf(log_buf + log_len, ELOG_LINE_BUF_SIZE - log_len, deferred.format, log);
+
+    return log_package_end(log_buf, log_len, fmt_result);
+}
+#endif /* ELOG_ASYNC_DEFERRED_FORMAT */
+
+/**
+ * output the log
+ *
+ * @param level level
+ * @param tag tag
+ * @param file file name
+ * @param func function name
+ * @param line line number
+ * @param format output format
+ * @param ... args
+ *
+ */
+void elog_output(uint8_t level, const char *tag, const char *file, const char *func,
+        const long line, const char *format, ...) {
+    size_t log_len = 0;
+    va_list args;
+    int fmt_result;
+
+    ELOG_ASSERT(level <= ELOG_LVL_VERBOSE);
+
+    /* check output enabled */
+    if (!elog.output_enabled) {
+        return;
+    }
+    /* level filter */
+    if (level > elog.filter.level || level > elog_get_filter_tag_lvl(tag)) {
+        return;
+    } else if (!strstr(tag, elog.filter.tag)) { /* tag filter */
+        return;
+    }
+    /* args point to the first variable parameter */
+    va_start(args, format);
+
+#ifdef ELOG_ASYNC_DEFERRED_FORMAT
+    extern bool elog_async_is_deferred(uint8_t level);
+    extern void elog_async_deferred_output(uint8_t level, const char *log, size_t size);
+    /* only package the format and arguments, it will be formatted on asynchronous output thread */
+    if (elog_async_is_deferred(level)) {
+        log_len = log_package_deferred(log_buf, level, tag, file, func, line, format, args);
+        if (log_len) {
+            va_end(args);
+            elog_async_deferred_output(level, log_buf, log_len);
+            return;
+        }
+        /* the format is not supported, so format it now */
+        va_end(args);
+        va_start(args, format);
+    }
+#endif
+
+    /* lock line buffer */
+    log_buf_lock();
+
+    /* package log header */
+    log_len = log_package_header(log_buf, level, tag, file, func, line, NULL, NULL, NULL);
+    /* package other log data to buffer. '\0' must be added in the end by vsnprintf. */
+    fmt_result = vsnprintf(log_buf + log_len, ELOG_LINE_BUF_SIZE - log_len, format, args);
+
+    va_end(args);
+    /* package log end and do keyword filter */
+    log_len = log_package_end(log_buf, log_len, fmt_result);
+    if (!log_len) {
+        /* unlock line buffer */
+        log_buf_unlock();
+        return;
+    }
+    /* lock output */
+    log_buf_output_lock();
     /* output log */
 #if defined(ELOG_ASYNC_OUTPUT_ENABLE)
     extern void elog_async_output(uint8_t level, const char *log, size_t size);
@@ -712,10 +1512,86 @@ void elog_output(uint8_t level, const char *tag, const char *file, const char *f
     elog_buf_output(log_buf, log_len);
 #else
     elog_port_output(log_buf, log_len);
+    port_output_flush(level);
 #endif
     /* unlock output */
-    elog_output_unlock();
+    log_buf_output_unlock();
+    /* unlock line buffer */
+    log_buf_unlock();
+}
+
+#ifdef ELOG_TOKENIZE_ENABLE
+/**
+ * output the tokenized log, it will be called by the log output macro when ELOG_TOKENIZE_ENABLE is defined
+ *
+ * The output frame is: sync byte(0xE7) + arguments length(2 bytes) + token ID(4 bytes) + packed arguments.
+ * The token ID is the offset of the token in elog_token section, the frame head and arguments are in the
+ * native byte order of target, so the decoder needs --big-endian for big endian target.
+ * @see tools/elog_token_decode.py
+ *
+ * @param level level
+ * @param tag tag
+ * @param token token in elog_token section
+ * @param format output format
+ * @param ... args
+ */
+void elog_token_output(uint8_t level, const char *tag, const char *token, const char *format, ...) {
+    extern const char __start_elog_token[];
+    size_t log_len = ELOG_TOKEN_HEAD_LEN, args_len;
+    uint32_t id = (uint32_t) (token - __start_elog_token);
+    uint16_t head_args_len;
+    va_list args;
+
+    ELOG_ASSERT(level <= ELOG_LVL_VERBOSE);
+
+    /* check output enabled */
+    if (!elog.output_enabled) {
+        return;
+    }
+    /* level filter */
+    if (level > elog.filter.level || level > elog_get_filter_tag_lvl(tag)) {
+        return;
+    } else if (!strstr(tag, elog.filter.tag)) { /* tag filter */
+        return;
+    }
+    /* args point to the first variable parameter */
+    va_start(args, format);
+
+    /* lock line buffer */
+    log_buf_lock();
+
+    args_len = elog_args_pack(log_buf + log_len, ELOG_LINE_BUF_SIZE - log_len, format, args);
+    va_end(args);
+    /* the arguments is not supported or too long, only output the token */
+    if (args_len > UINT16_MAX) {
+        args_len = 0;
+    }
+    log_len += args_len;
+    /* package the frame head, it is in the same byte order as the packed arguments */
+    head_args_len = (uint16_t) args_len;
+    log_buf[0] = (char) ELOG_TOKEN_SYNC;
+    memcpy(log_buf + 1, &head_args_len, sizeof(head_args_len));
+    memcpy(log_buf + 3, &id, sizeof(id));
+
+    /* lock output */
+    log_buf_output_lock();
+    /* output log */
+#if defined(ELOG_ASYNC_OUTPUT_ENABLE)
+    extern void elog_async_output(uint8_t level, const char *log, size_t size);
+    elog_async_output(level, log_buf, log_len);
+#elif defined(ELOG_BUF_OUTPUT_ENABLE)
+    extern void elog_buf_output(const char *log, size_t size);
+    elog_buf_output(log_buf, log_len);
+#else
+    elog_port_output(log_buf, log_len);
+    port_output_flush(level);
+#endif
+    /* unlock output */
+    log_buf_output_unlock();
+    /* unlock line buffer */
+    log_buf_unlock();
 }
+#endif /* ELOG_TOKENIZE_ENABLE */
 
 /**
  * get format enabled
@@ -735,6 +1611,116 @@ static bool get_fmt_enabled(uint8_t level, size_t set) {
     }
 }
 
+/**
+ * add a step to the format plan
+ *
+ * @param plan format plan
+ * @param type step type
+ */
+static void fmt_plan_add_step(FmtPlan *plan, FmtStepType type) {
+    ELOG_ASSERT(plan->step_num < FMT_PLAN_MAX_STEP - 1);
+
+    plan->step[plan->step_num].type = type;
+    plan->step_num++;
+}
+
+/**
+ * add a literal step to the format plan, it will be merged into the previous literal step
+ *
+ * @param plan format plan
+ * @param literal literal string
+ */
+static void fmt_plan_add_literal(FmtPlan *plan, const char *literal) {
+    size_t len = strlen(literal);
+    FmtStep *last = plan->step_num ? &plan->step[plan->step_num - 1] : NULL;
+
+    ELOG_ASSERT(plan->literal_len + len <= FMT_PLAN_LITERAL_SIZE);
+
+    if (!last || last->type != FMT_STEP_LITERAL) {
+        fmt_plan_add_step(plan, FMT_STEP_LITERAL);
+        last = &plan->step[plan->step_num - 1];
+        last->offset = plan->literal_len;
+        last->len = 0;
+    }
+    memcpy(plan->literal + plan->literal_len, literal, len);
+    plan->literal_len += len;
+    last->len += len;
+}
+
+/**
+ * compile the log header format plan of the level by its format set and color status
+ *
+ * @param level level
+ */
+static void fmt_plan_compile(uint8_t level) {
+    FmtPlan plan = { 0 };
+
+#ifdef ELOG_COLOR_ENABLE
+    /* add CSI start sign and color info */
+    if (elog.text_color_enabled) {
+        fmt_plan_add_literal(&plan, CSI_START);
+        fmt_plan_add_literal(&plan, color_output_info[level]);
+    }
+#endif
+
+    /* level info */
+    if (get_fmt_enabled(level, ELOG_FMT_LVL)) {
+        fmt_plan_add_literal(&plan, level_output_info[level]);
+    }
+    /* tag info */
+    if (get_fmt_enabled(level, ELOG_FMT_TAG)) {
+        fmt_plan_add_step(&plan, FMT_STEP_TAG);
+    }
+    /* time, process and thread info */
+    if (get_fmt_enabled(level, ELOG_FMT_TIME | ELOG_FMT_P_INFO | ELOG_FMT_T_INFO)) {
+        fmt_plan_add_literal(&plan, "[");
+        if (get_fmt_enabled(level, ELOG_FMT_TIME)) {
+            fmt_plan_add_step(&plan, FMT_STEP_TIME);
+            if (get_fmt_enabled(level, ELOG_FMT_P_INFO | ELOG_FMT_T_INFO)) {
+                fmt_plan_add_literal(&plan, " ");
+            }
+        }
+        if (get_fmt_enabled(level, ELOG_FMT_P_INFO)) {
+            fmt_plan_add_step(&plan, FMT_STEP_P_INFO);
+            if (get_fmt_enabled(level, ELOG_FMT_T_INFO)) {
+                fmt_plan_add_literal(&plan, " ");
+            }
+        }
+        if (get_fmt_enabled(level, ELOG_FMT_T_INFO)) {
+            fmt_plan_add_step(&plan, FMT_STEP_T_INFO);
+        }
+        fmt_plan_add_literal(&plan, "] ");
+    }
+    /* file directory and name, function name and line number info */
+    if (get_fmt_enabled(level, ELOG_FMT_DIR | ELOG_FMT_FUNC | ELOG_FMT_LINE)) {
+        fmt_plan_add_literal(&plan, "(");
+        if (get_fmt_enabled(level, ELOG_FMT_DIR)) {
+            fmt_plan_add_step(&plan, FMT_STEP_DIR);
+            if (get_fmt_enabled(level, ELOG_FMT_FUNC)) {
+                fmt_plan_add_literal(&plan, ":");
+            } else if (get_fmt_enabled(level, ELOG_FMT_LINE)) {
+                fmt_plan_add_literal(&plan, " ");
+            }
+        }
+        if (get_fmt_enabled(level, ELOG_FMT_LINE)) {
+            fmt_plan_add_step(&plan, FMT_STEP_LINE);
+            if (get_fmt_enabled(level, ELOG_FMT_FUNC)) {
+                fmt_plan_add_literal(&plan, " ");
+            }
+        }
+        if (get_fmt_enabled(level, ELOG_FMT_FUNC)) {
+            fmt_plan_add_step(&plan, FMT_STEP_FUNC);
+        }
+        fmt_plan_add_literal(&plan, ")");
+    }
+    /* the step after last one is always FMT_STEP_END */
+    elog_output_lock();
+    fmt_write_begin();
+    fmt_plan[level] = plan;
+    fmt_write_end();
+    elog_output_unlock();
+}
+
 /**
  * enable or disable logger output lock
  * @note disable this lock is not recommended except you want output system exception log
@@ -855,8 +1841,10 @@ void elog_hexdump(const char *name, uint8_t width, const void *buf, uint16_t siz
     uint16_t i, j;
     uint16_t log_len = 0;
     const uint8_t *buf_p = buf;
-    char dump_string[8] = {0};
+    char dump_string[4];
+    uint8_t dump_len;
     int fmt_result;
+    static const char hex_digits[] = "0123456789ABCDEF";
 
     if (!elog.output_enabled) {
         return;
@@ -869,8 +1857,8 @@ void elog_hexdump(const char *name, uint8_t width, const void *buf, uint16_t siz
         return;
     }
 
-    /* lock output */
-    elog_output_lock();
+    /* lock line buffer */
+    log_buf_lock();
 
     for (i = 0; i < size; i += width) {
         /* package header */
@@ -884,29 +1872,29 @@ void elog_hexdump(const char *name, uint8_t width, const void *buf, uint16_t siz
         /* dump hex */
         for (j = 0; j < width; j++) {
             if (i + j < size) {
-                snprintf(dump_string, sizeof(dump_string), "%02X ", buf_p[i + j]);
+                dump_string[0] = hex_digits[buf_p[i + j] >> 4];
+                dump_string[1] = hex_digits[buf_p[i + j] & 0x0F];
             } else {
-                strncpy(dump_string, "   ", sizeof(dump_string));
-            }
-            log_len += elog_strcpy(log_len, log_buf + log_len, dump_string);
-            if ((j + 1) % 8 == 0) {
-                log_len += elog_strcpy(log_len, log_buf + log_len, " ");
+                dump_string[0] = dump_string[1] = ' ';
             }
+            dump_string[2] = dump_string[3] = ' ';
+            /* add a space after every 8 hex */
+            dump_len = ((j + 1) % 8 == 0) ? 4 : 3;
+            log_len += elog_strncpy(log_len, log_buf + log_len, dump_string, dump_len);
         }
-        log_len += elog_strcpy(log_len, log_buf + log_len, "  ");
+        log_len += log_strcpy_literal(log_len, log_buf + log_len, "  ");
         /* dump char for hex */
-        for (j = 0; j < width; j++) {
-            if (i + j < size) {
-                snprintf(dump_string, sizeof(dump_string), "%c", __is_print(buf_p[i + j]) ? buf_p[i + j] : '.');
-                log_len += elog_strcpy(log_len, log_buf + log_len, dump_string);
-            }
+        for (j = 0; j < width && i + j < size && log_len < ELOG_LINE_BUF_SIZE; j++) {
+            log_buf[log_len++] = __is_print(buf_p[i + j]) ? buf_p[i + j] : '.';
         }
         /* overflow check and reserve some space for newline sign */
-        if (log_len + strlen(ELOG_NEWLINE_SIGN) > ELOG_LINE_BUF_SIZE) {
-            log_len = ELOG_LINE_BUF_SIZE - strlen(ELOG_NEWLINE_SIGN);
+        if (log_len + sizeof(ELOG_NEWLINE_SIGN) - 1 > ELOG_LINE_BUF_SIZE) {
+            log_len = ELOG_LINE_BUF_SIZE - (sizeof(ELOG_NEWLINE_SIGN) - 1);
         }
         /* package newline sign */
-        log_len += elog_strcpy(log_len, log_buf + log_len, ELOG_NEWLINE_SIGN);
+        log_len += log_strcpy_literal(log_len, log_buf + log_len, ELOG_NEWLINE_SIGN);
+        /* lock output */
+        log_buf_output_lock();
         /* do log output */
 #if defined(ELOG_ASYNC_OUTPUT_ENABLE)
         extern void elog_async_output(uint8_t level, const char *log, size_t size);
@@ -917,9 +1905,11 @@ void elog_hexdump(const char *name, uint8_t width, const void *buf, uint16_t siz
 #else
         elog_port_output(log_buf, log_len);
 #endif
+        /* unlock output */
+        log_buf_output_unlock();
     }
-    /* unlock output */
-    elog_output_unlock();
+    /* unlock line buffer */
+    log_buf_unlock();
 }
 
 extern int elog_port_setchannel(Log_Channel channel);
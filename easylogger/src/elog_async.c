@@ -28,6 +28,7 @@
 
 #include <elog.h>
 #include <string.h>
+#include <stdio.h>
 
 #ifdef ELOG_ASYNC_OUTPUT_ENABLE
 
@@ -35,6 +36,7 @@
 #include <pthread.h>
 #include <sched.h>
 #include <semaphore.h>
+#include <time.h>
 /* thread default stack size */
 #ifndef ELOG_ASYNC_OUTPUT_PTHREAD_STACK_SIZE
 #if PTHREAD_STACK_MIN > 4*1024
@@ -42,6 +44,7 @@
 #else
 #define ELOG_ASYNC_OUTPUT_PTHREAD_STACK_SIZE     (1*1024)
 #endif
+#endif /* ELOG_ASYNC_OUTPUT_PTHREAD_STACK_SIZE */
 /* thread default priority */
 #ifndef ELOG_ASYNC_OUTPUT_PTHREAD_PRIORITY
 #define ELOG_ASYNC_OUTPUT_PTHREAD_PRIORITY       (sched_get_priority_max(SCHED_RR) - 1)
@@ -56,34 +59,906 @@
 #define ELOG_ASYNC_POLL_GET_LOG_BUF_SIZE         (ELOG_LINE_BUF_SIZE - 4)
 #endif
 #endif
-#endif /* ELOG_ASYNC_OUTPUT_USING_PTHREAD */
+/* the waiting output thread will be woken up when the buffered log size reaches the watermark, 0: every log */
+#ifndef ELOG_ASYNC_OUTPUT_WAKEUP_WATERMARK
+#define ELOG_ASYNC_OUTPUT_WAKEUP_WATERMARK       0
+#endif
+/* the output thread max waiting time (ms) when the buffered log size is less than the watermark */
+#ifndef ELOG_ASYNC_OUTPUT_WAKEUP_TIMEOUT
+#define ELOG_ASYNC_OUTPUT_WAKEUP_TIMEOUT         10
+#endif
 
 /* asynchronous output log notice */
 static sem_t output_notice;
+/* output thread state, the producer only notices the output thread when it is waiting */
+#define OUTPUT_THREAD_RUNNING                    0
+#define OUTPUT_THREAD_WAITING                    1
+/* the output thread is waiting for more log until the watermark is reached or timeout */
+#define OUTPUT_THREAD_BATCHING                   2
+static int output_thread_state = OUTPUT_THREAD_RUNNING;
 /* asynchronous output pthread thread */
 static pthread_t async_output_thread;
-#endif /* ELOG_ASYNC_OUTPUT_ENABLE */
+#endif /* ELOG_ASYNC_OUTPUT_USING_PTHREAD */
+
+/* the highest output level for async mode, other level will sync output */
+#ifdef ELOG_ASYNC_OUTPUT_LVL
+#define OUTPUT_LVL                               ELOG_ASYNC_OUTPUT_LVL
+#else
+#define OUTPUT_LVL                               ELOG_LVL_ASSERT
+#endif /* ELOG_ASYNC_OUTPUT_LVL */
+
+/* buffer size for asynchronous output mode */
+#ifdef ELOG_ASYNC_OUTPUT_BUF_SIZE
+#define OUTPUT_BUF_SIZE                          ELOG_ASYNC_OUTPUT_BUF_SIZE
+#else
+#define OUTPUT_BUF_SIZE                          (ELOG_LINE_BUF_SIZE * 10)
+#endif /* ELOG_ASYNC_OUTPUT_BUF_SIZE */
+
+/* the policy when asynchronous output ring buffer has no enough space for new log */
+#ifndef ELOG_ASYNC_OUTPUT_FULL_POLICY
+#ifdef ELOG_ASYNC_OUTPUT_LOCK_FREE
+#define ELOG_ASYNC_OUTPUT_FULL_POLICY            ELOG_ASYNC_FULL_DROP_NEWEST
+#else
+#define ELOG_ASYNC_OUTPUT_FULL_POLICY            ELOG_ASYNC_FULL_TRUNCATE
+#endif
+#endif /* ELOG_ASYNC_OUTPUT_FULL_POLICY */
+/* the max waiting time (ms) for the space when using ELOG_ASYNC_FULL_BLOCK policy */
+#ifndef ELOG_ASYNC_OUTPUT_BLOCK_TIMEOUT
+#define ELOG_ASYNC_OUTPUT_BLOCK_TIMEOUT          100
+#endif
+
+#if ELOG_ASYNC_OUTPUT_FULL_POLICY == ELOG_ASYNC_FULL_DROP_OLDEST && defined(ELOG_ASYNC_OUTPUT_LOCK_FREE)
+    #error "The drop oldest policy is not supported by lock free async output (in elog_cfg.h)"
+#endif
+
+#if ELOG_ASYNC_OUTPUT_FULL_POLICY == ELOG_ASYNC_FULL_BLOCK && (!defined(ELOG_ASYNC_OUTPUT_LOCK_FREE) \
+        || !defined(ELOG_ASYNC_OUTPUT_USING_PTHREAD))
+    #error "The block policy depends on lock free async output and pthread (in elog_cfg.h)"
+#endif
+
+#ifdef ELOG_ASYNC_OUTPUT_BATCH
+/* max number of the log buffer vector which is got by batch */
+#ifndef ELOG_ASYNC_OUTPUT_BATCH_MAX_NUM
+#define ELOG_ASYNC_OUTPUT_BATCH_MAX_NUM          64
+#endif
+#ifdef ELOG_ASYNC_DEFERRED_FORMAT
+/* the buffer size for the deferred format logs of a batch, it must be larger than ELOG_LINE_BUF_SIZE */
+#ifndef ELOG_ASYNC_DEFERRED_BATCH_BUF_SIZE
+#define ELOG_ASYNC_DEFERRED_BATCH_BUF_SIZE       (ELOG_LINE_BUF_SIZE * 8)
+#endif
+#if ELOG_ASYNC_DEFERRED_BATCH_BUF_SIZE < ELOG_LINE_BUF_SIZE
+    #error "The ELOG_ASYNC_DEFERRED_BATCH_BUF_SIZE must be larger than ELOG_LINE_BUF_SIZE (in elog_cfg.h)"
+#endif
+#endif /* ELOG_ASYNC_DEFERRED_FORMAT */
+#endif /* ELOG_ASYNC_OUTPUT_BATCH */
+
+/* Initialize OK flag */
+static bool init_ok = false;
+#ifdef ELOG_ASYNC_OUTPUT_USING_PTHREAD
+/* thread running flag */
+static bool thread_running = false;
+#endif
+/* asynchronous output mode enabled flag */
+static bool is_enabled = false;
+
+extern void elog_port_output(const char *log, size_t size);
+extern void elog_output_lock(void);
+extern void elog_output_unlock(void);
+static void async_output_notice(bool full);
+
+#ifdef ELOG_OUTPUT_FLUSH_LVL
+extern void elog_port_output_flush(void);
+/* flush the port output after the high level log is output */
+#define port_output_flush(level)                                                                    \
+    do {                                                                                            \
+        if ((level) <= ELOG_OUTPUT_FLUSH_LVL) {                                                     \
+            elog_port_output_flush();                                                               \
+        }                                                                                           \
+    } while (0)
+#ifdef ELOG_ASYNC_OUTPUT_USING_PTHREAD
+/* the high level log is put to ring buffer, the output thread will flush the port after outputting it */
+static bool output_flush_pending = false;
+#define output_flush_request(level)                                                                 \
+    do {                                                                                            \
+        if ((level) <= ELOG_OUTPUT_FLUSH_LVL) {                                                     \
+            __atomic_store_n(&output_flush_pending, true, __ATOMIC_RELEASE);                        \
+        }                                                                                           \
+    } while (0)
+#else
+/* the user output the log from ring buffer by itself */
+#define output_flush_request(level)
+#endif
+#else
+#define port_output_flush(level)
+#define output_flush_request(level)
+#endif /* ELOG_OUTPUT_FLUSH_LVL */
+
+#ifdef ELOG_ASYNC_OUTPUT_STAT_ENABLE
+/* dropped log count of every level */
+static size_t drop_count[ELOG_LVL_TOTAL_NUM] = { 0 };
+/* the old line log count which is dropped by ELOG_ASYNC_FULL_DROP_OLDEST policy */
+static size_t drop_oldest_count = 0;
+/* dropped log count which is not reported by summary log */
+static size_t drop_pending[ELOG_LVL_TOTAL_NUM] = { 0 };
+static size_t drop_oldest_pending = 0;
+static size_t drop_pending_total = 0;
+/* the max used size of ring buffer */
+static size_t buf_used_max = 0;
+/* the drop summary log is being put by a producer */
+static bool drop_summary_putting = false;
+
+#if defined(__GNUC__)
+/* the statistics are updated by producers without lock */
+#define stat_load(var)                           __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define stat_store(var, val)                     __atomic_store_n(&(var), (val), __ATOMIC_RELAXED)
+#define stat_add(var, val)                       __atomic_fetch_add(&(var), (val), __ATOMIC_RELAXED)
+#define stat_sub(var, val)                       __atomic_fetch_sub(&(var), (val), __ATOMIC_RELAXED)
+#define stat_exchange(var, val)                  __atomic_exchange_n(&(var), (val), __ATOMIC_RELAXED)
+#define stat_update_max(var, val)                                                                   \
+    do {                                                                                            \
+        size_t stat_max = __atomic_load_n(&(var), __ATOMIC_RELAXED);                                \
+        while ((val) > stat_max && !__atomic_compare_exchange_n(&(var), &stat_max, (val), true,     \
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED));                                               \
+    } while (0)
+#define drop_summary_trylock()                   (!__atomic_exchange_n(&drop_summary_putting, true, __ATOMIC_ACQUIRE))
+#define drop_summary_unlock()                    __atomic_store_n(&drop_summary_putting, false, __ATOMIC_RELEASE)
+#else
+/* the lock free ring buffer depends on GNU atomic builtins, so only the locked ring buffer is used here,
+ * its statistics are updated by producers in output lock */
+#define stat_load(var)                           (var)
+#define stat_store(var, val)                     ((var) = (val))
+#define stat_add(var, val)                       ((var) += (val))
+#define stat_sub(var, val)                       ((var) -= (val))
+#define stat_exchange(var, val)                  stat_exchange_size(&(var), (val))
+#define stat_update_max(var, val)                                                                   \
+    do {                                                                                            \
+        if ((val) > (var)) {                                                                        \
+            (var) = (val);                                                                          \
+        }                                                                                           \
+    } while (0)
+#define drop_summary_trylock()                   (drop_summary_putting ? false : (drop_summary_putting = true))
+#define drop_summary_unlock()                    (drop_summary_putting = false)
+
+static size_t stat_exchange_size(size_t *var, size_t val) {
+    size_t old = *var;
+
+    *var = val;
+    return old;
+}
+#endif /* defined(__GNUC__) */
+#endif /* ELOG_ASYNC_OUTPUT_STAT_ENABLE */
+
+#if defined(ELOG_ASYNC_OUTPUT_PER_THREAD) && !defined(ELOG_ASYNC_OUTPUT_LOCK_FREE)
+    #error "Please enable lock free async output when using per-thread ring (in elog_cfg.h)"
+#endif
+
+#if defined(ELOG_ASYNC_DEFERRED_FORMAT) && !defined(ELOG_ASYNC_OUTPUT_LOCK_FREE)
+    #error "Please enable lock free async output when using deferred format (in elog_cfg.h)"
+#endif
+
+#ifdef ELOG_ASYNC_OUTPUT_LOCK_FREE
+#if !defined(__GNUC__)
+    #error "The lock free async output requires GNU atomic builtins (in elog_cfg.h)"
+#endif
+#if !defined(ELOG_LINE_BUF_THREAD_LOCAL)
+    #error "Please enable thread local line buffer when using lock free async output (in elog_cfg.h)"
+#endif
+
+/**
+ * The lock free ring buffer is made of records. Every record has a 32-bit header which is
+ * followed by the log data, the record is contiguous and aligned with 4 bytes.
+ * Producer reserves the record space by atomic increasing the write position, then copies
+ * the log and commits it by setting the header. Consumer only gets the committed records.
+ */
+#define RECORD_COMMITTED                         0x80000000UL
+#define RECORD_PADDING                           0x40000000UL
+/* the record is a deferred format log, it will be formatted when consumer gets it */
+#define RECORD_DEFERRED                          0x20000000UL
+#define RECORD_SIZE_MASK                         0x1FFFFFFFUL
+#define RECORD_ALIGN_SIZE                        sizeof(uint32_t)
+#define RECORD_ALIGN(size)                       (((size) + RECORD_ALIGN_SIZE - 1) & ~(RECORD_ALIGN_SIZE - 1))
+#define RING_BUF_SIZE(size)                      ((size) / RECORD_ALIGN_SIZE * RECORD_ALIGN_SIZE)
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD_ORDERED
+/* the record header has a 32-bit global sequence number for merging the per-thread rings */
+#define RECORD_HEADER_SIZE                       (sizeof(uint32_t) * 2)
+#else
+#define RECORD_HEADER_SIZE                       sizeof(uint32_t)
+#endif
+
+/* lock free ring buffer */
+typedef struct {
+    uint32_t *buf;
+    /* ring buffer size, it is aligned with 4 bytes */
+    size_t size;
+    /* write position, it is increased by producers */
+    size_t write_pos;
+    /* read position, it is only increased by consumer */
+    size_t read_pos;
+    /* the read size of current record which is not got completely by consumer */
+    size_t record_read_size;
+    /* only one producer, so the write position can be increased without CAS */
+    bool single_producer;
+#ifdef ELOG_ASYNC_OUTPUT_BATCH
+    /* the position after the records which are got by batch, they are released after output */
+    size_t batch_pos;
+#endif
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD
+    /* the ring is owned by a thread */
+    bool used;
+    /* the owner thread has exited, the ring will be released after it is empty */
+    bool owner_exited;
+#endif
+} AsyncRing;
+
+/* asynchronous output mode's lock free ring buffer */
+static uint32_t log_buf[RING_BUF_SIZE(OUTPUT_BUF_SIZE) / sizeof(uint32_t)] = { 0 };
+static AsyncRing log_ring = { .buf = log_buf, .size = RING_BUF_SIZE(OUTPUT_BUF_SIZE) };
+
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD
+/* max number of the per-thread ring, the thread will use the shared ring when all rings are used */
+#ifndef ELOG_ASYNC_THREAD_RING_MAX_NUM
+#define ELOG_ASYNC_THREAD_RING_MAX_NUM           8
+#endif
+/* buffer size for every per-thread ring */
+#ifndef ELOG_ASYNC_THREAD_RING_BUF_SIZE
+#define ELOG_ASYNC_THREAD_RING_BUF_SIZE          (ELOG_LINE_BUF_SIZE * 8)
+#endif
+#define THREAD_RING_BUF_SIZE                     RING_BUF_SIZE(ELOG_ASYNC_THREAD_RING_BUF_SIZE)
+/* total size of all ring buffers */
+#define ASYNC_BUF_SIZE                           (RING_BUF_SIZE(OUTPUT_BUF_SIZE) \
+                                                 + THREAD_RING_BUF_SIZE * ELOG_ASYNC_THREAD_RING_MAX_NUM)
+
+/* per-thread rings buffer */
+static uint32_t thread_ring_buf[ELOG_ASYNC_THREAD_RING_MAX_NUM][THREAD_RING_BUF_SIZE / sizeof(uint32_t)];
+/* per-thread single producer single consumer rings */
+static AsyncRing thread_rings[ELOG_ASYNC_THREAD_RING_MAX_NUM];
+/* current thread's ring */
+static ELOG_THREAD_LOCAL AsyncRing *cur_thread_ring = NULL;
+/* the ring which is got by consumer last time */
+static size_t consumer_ring_index = 0;
+#ifdef ELOG_ASYNC_OUTPUT_USING_PTHREAD
+/* release the ring when thread exit */
+static pthread_key_t thread_ring_key;
+#endif
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD_ORDERED
+/* global record sequence number */
+static uint32_t record_seq = 0;
+#endif
+#else
+/* total size of all ring buffers */
+#define ASYNC_BUF_SIZE                           RING_BUF_SIZE(OUTPUT_BUF_SIZE)
+#endif /* ELOG_ASYNC_OUTPUT_PER_THREAD */
+
+#ifdef ELOG_ASYNC_DEFERRED_FORMAT
+/* the formatted log of deferred format record which is got by consumer */
+static char deferred_log_buf[ELOG_LINE_BUF_SIZE];
+/* the formatted log size of deferred format record */
+static size_t deferred_log_size = 0;
+#ifdef ELOG_ASYNC_OUTPUT_BATCH
+/* the formatted logs of deferred format records which are got by batch */
+static char deferred_batch_buf[ELOG_ASYNC_DEFERRED_BATCH_BUF_SIZE];
+#endif
+#endif
+
+/**
+ * get the record address on lock free ring buffer
+ *
+ * @param ring ring buffer
+ * @param pos record position
+ *
+ * @return record header address
+ */
+static uint32_t *async_get_record(AsyncRing *ring, size_t pos) {
+    return (uint32_t *)((char *)ring->buf + pos % ring->size);
+}
+
+/**
+ * put log to lock free ring buffer as a record
+ *
+ * @param ring ring buffer
+ * @param log put log buffer
+ * @param size log size
+ * @param flags record flags
+ *
+ * @return put log size, the log will be dropped when ring buffer has no enough space
+ */
+static size_t async_ring_put_log(AsyncRing *ring, const char *log, size_t size, uint32_t flags) {
+    size_t pos, offset, record_size, reserve_size;
+    uint32_t *record;
+
+    record_size = RECORD_HEADER_SIZE + RECORD_ALIGN(size);
+    if (record_size > ring->size) {
+        return 0;
+    }
+    /* reserve the record space */
+    pos = __atomic_load_n(&ring->write_pos, __ATOMIC_RELAXED);
+    do {
+        offset = pos % ring->size;
+        reserve_size = record_size;
+        /* the record must be contiguous, so the tail of ring buffer will be padded */
+        if (offset + record_size > ring->size) {
+            reserve_size += ring->size - offset;
+        }
+        /* no space */
+        if (pos + reserve_size - __atomic_load_n(&ring->read_pos, __ATOMIC_ACQUIRE) > ring->size) {
+            return 0;
+        }
+        if (ring->single_producer) {
+            __atomic_store_n(&ring->write_pos, pos + reserve_size, __ATOMIC_RELAXED);
+            break;
+        }
+    } while (!__atomic_compare_exchange_n(&ring->write_pos, &pos, pos + reserve_size, true, __ATOMIC_ACQUIRE,
+            __ATOMIC_RELAXED));
+    /* commit the padding record */
+    if (reserve_size != record_size) {
+        __atomic_store_n(async_get_record(ring, pos), RECORD_COMMITTED | RECORD_PADDING, __ATOMIC_RELEASE);
+        pos += reserve_size - record_size;
+    }
+    /* copy the log and commit the record */
+    record = async_get_record(ring, pos);
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD_ORDERED
+    record[1] = __atomic_fetch_add(&record_seq, 1, __ATOMIC_RELAXED);
+#endif
+    memcpy((char *)record + RECORD_HEADER_SIZE, log, size);
+    __atomic_store_n(record, RECORD_COMMITTED | flags | size, __ATOMIC_RELEASE);
+
+    return size;
+}
+
+/**
+ * get the first committed record on lock free ring buffer, the padding record will be skipped
+ *
+ * @param ring ring buffer
+ *
+ * @return the record header address, NULL: no committed record
+ */
+static uint32_t *async_ring_peek_record(AsyncRing *ring) {
+    size_t pos = ring->read_pos, record_size;
+    uint32_t *record, header;
+
+    while (pos != __atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE)) {
+        record = async_get_record(ring, pos);
+        header = __atomic_load_n(record, __ATOMIC_ACQUIRE);
+        /* the record is not committed yet */
+        if (!(header & RECORD_COMMITTED)) {
+            break;
+        }
+        if (!(header & RECORD_PADDING)) {
+            return record;
+        }
+        /* the free space must be cleared, so the stale data will not be treated as committed header */
+        record_size = ring->size - pos % ring->size;
+        memset(record, 0, record_size);
+        pos += record_size;
+        /* release the space for producers */
+        __atomic_store_n(&ring->read_pos, pos, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+/**
+ * get the first committed record log from lock free ring buffer without copy
+ *
+ * @param ring ring buffer
+ * @param record the first committed record, @see async_ring_peek_record
+ * @param size the log size which is not committed
+ *
+ * @return the log which is not committed
+ */
+static const char *async_ring_peek_record_log(AsyncRing *ring, uint32_t *record, size_t *size) {
+    size_t log_size;
+    const char *record_log = (char *)record + RECORD_HEADER_SIZE;
+
+    log_size = *record & RECORD_SIZE_MASK;
+#ifdef ELOG_ASYNC_DEFERRED_FORMAT
+    if (*record & RECORD_DEFERRED) {
+        extern size_t elog_deferred_format(char *log_buf, const char *log);
+        /* format the deferred format log when consumer gets it at first time */
+        if (!ring->record_read_size) {
+            deferred_log_size = elog_deferred_format(deferred_log_buf, record_log);
+        }
+        record_log = deferred_log_buf;
+        log_size = deferred_log_size;
+    }
+#endif
+    *size = log_size - ring->record_read_size;
+
+    return record_log + ring->record_read_size;
+}
+
+/**
+ * commit the read log size of the first committed record, the record will be released when
+ * all of its log is committed
+ *
+ * @param ring ring buffer
+ * @param record the first committed record, @see async_ring_peek_record
+ * @param size committed log size, it must be less than the size which is got by peek
+ */
+static void async_ring_commit_record_log(AsyncRing *ring, uint32_t *record, size_t size) {
+    size_t log_size, record_size;
+
+    log_size = *record & RECORD_SIZE_MASK;
+#ifdef ELOG_ASYNC_DEFERRED_FORMAT
+    if (*record & RECORD_DEFERRED) {
+        log_size = deferred_log_size;
+    }
+#endif
+    ring->record_read_size += size;
+    if (ring->record_read_size < log_size) {
+        return;
+    }
+    ring->record_read_size = 0;
+    /* the free space must be cleared, so the stale data will not be treated as committed header */
+    record_size = RECORD_HEADER_SIZE + RECORD_ALIGN(*record & RECORD_SIZE_MASK);
+    memset(record, 0, record_size);
+    /* release the space for producers */
+    __atomic_store_n(&ring->read_pos, ring->read_pos + record_size, __ATOMIC_RELEASE);
+}
+
+/**
+ * get the first committed record log from lock free ring buffer
+ *
+ * @param ring ring buffer
+ * @param record the first committed record, @see async_ring_peek_record
+ * @param log get log buffer
+ * @param size log size
+ *
+ * @return get log size, the part of record will be got when size is not enough
+ */
+static size_t async_ring_get_record_log(AsyncRing *ring, uint32_t *record, char *log, size_t size) {
+    size_t log_size;
+    const char *record_log;
+
+    record_log = async_ring_peek_record_log(ring, record, &log_size);
+    if (log_size > size) {
+        /* get the part of record log */
+        log_size = size;
+    }
+    memcpy(log, record_log, log_size);
+    async_ring_commit_record_log(ring, record, log_size);
+
+    return log_size;
+}
+
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD
+#ifdef ELOG_ASYNC_OUTPUT_USING_PTHREAD
+/**
+ * release the per-thread ring when its owner thread exit
+ *
+ * @param ring the per-thread ring
+ */
+static void async_thread_ring_release(void *ring) {
+    __atomic_store_n(&((AsyncRing *)ring)->owner_exited, true, __ATOMIC_RELEASE);
+}
+#endif
+
+/**
+ * get current thread's ring, it will be registered on first use
+ *
+ * @return current thread's ring, the shared ring will be returned when all per-thread rings are used
+ */
+static AsyncRing *async_get_thread_ring(void) {
+    size_t i;
+
+    if (cur_thread_ring) {
+        return cur_thread_ring;
+    }
+    /* using the shared ring when all per-thread rings are used */
+    cur_thread_ring = &log_ring;
+    for (i = 0; i < ELOG_ASYNC_THREAD_RING_MAX_NUM; i++) {
+        if (!__atomic_load_n(&thread_rings[i].used, __ATOMIC_RELAXED)
+                && !__atomic_exchange_n(&thread_rings[i].used, true, __ATOMIC_ACQUIRE)) {
+            cur_thread_ring = &thread_rings[i];
+#ifdef ELOG_ASYNC_OUTPUT_USING_PTHREAD
+            pthread_setspecific(thread_ring_key, cur_thread_ring);
+#endif
+            break;
+        }
+    }
+
+    return cur_thread_ring;
+}
+
+/**
+ * get the next ring which has committed record for consumer
+ *
+ * @param record the first committed record on found ring
+ * @param peek the function which peeks the first committed record on ring
+ *
+ * @return found ring, NULL: all rings are empty
+ */
+static AsyncRing *async_get_next_ring(uint32_t **record, uint32_t *(*peek)(AsyncRing *ring)) {
+    AsyncRing *ring, *found_ring = NULL;
+    uint32_t *ring_record;
+    size_t i, index;
+
+    /* the part of record log has been got, so it must be continue */
+    if (consumer_ring_index < ELOG_ASYNC_THREAD_RING_MAX_NUM) {
+        ring = &thread_rings[consumer_ring_index];
+    } else {
+        ring = &log_ring;
+    }
+    if (ring->record_read_size) {
+        *record = peek(ring);
+        return ring;
+    }
+    /* index ELOG_ASYNC_THREAD_RING_MAX_NUM is the shared ring */
+    for (i = 1; i <= ELOG_ASYNC_THREAD_RING_MAX_NUM + 1; i++) {
+        index = (consumer_ring_index + i) % (ELOG_ASYNC_THREAD_RING_MAX_NUM + 1);
+        if (index < ELOG_ASYNC_THREAD_RING_MAX_NUM) {
+            ring = &thread_rings[index];
+            if (!__atomic_load_n(&ring->used, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+        } else {
+            ring = &log_ring;
+        }
+        ring_record = peek(ring);
+        if (!ring_record) {
+            /* the ring is empty and its owner thread has exited, so release it */
+            if (ring != &log_ring && __atomic_load_n(&ring->owner_exited, __ATOMIC_ACQUIRE)) {
+                ring->owner_exited = false;
+                __atomic_store_n(&ring->used, false, __ATOMIC_RELEASE);
+            }
+            continue;
+        }
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD_ORDERED
+        /* merge by the sequence number, the record which has the smallest number will be found */
+        if (found_ring && (int32_t)(ring_record[1] - (*record)[1]) >= 0) {
+            continue;
+        }
+        found_ring = ring;
+        *record = ring_record;
+        consumer_ring_index = index;
+#else
+        /* round-robin */
+        found_ring = ring;
+        *record = ring_record;
+        consumer_ring_index = index;
+        break;
+#endif
+    }
+
+    return found_ring;
+}
+#endif /* ELOG_ASYNC_OUTPUT_PER_THREAD */
+
+/**
+ * get committed records log from lock free ring buffers
+ *
+ * @param log get log buffer
+ * @param size log size
+ * @param line true: only get one record, it is one line log
+ *
+ * @return get log size
+ */
+static size_t async_get_record_log(char *log, size_t size, bool line) {
+    size_t cpy_log_size = 0, log_size;
+    AsyncRing *ring = &log_ring;
+    uint32_t *record;
+
+    while (cpy_log_size < size) {
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD
+        ring = async_get_next_ring(&record, async_ring_peek_record);
+        if (!ring) {
+            break;
+        }
+#else
+        record = async_ring_peek_record(ring);
+#endif
+        if (!record) {
+            break;
+        }
+        log_size = async_ring_get_record_log(ring, record, log + cpy_log_size, size - cpy_log_size);
+        cpy_log_size += log_size;
+        /* the deferred format log which is filtered has no log */
+        if (line && log_size) {
+            break;
+        }
+    }
+
+    return cpy_log_size;
+}
+
+#ifdef ELOG_ASYNC_LINE_OUTPUT
+/**
+ * Get line log from asynchronous output ring buffer.
+ * Every record is a line log, the part of record will be got when size is not enough.
+ *
+ * @param log get line log buffer
+ * @param size line log size
+ *
+ * @return get line log size
+ */
+size_t elog_async_get_line_log(char *log, size_t size) {
+    return async_get_record_log(log, size, true);
+}
+#else
+/**
+ * get log from asynchronous output ring buffer
+ *
+ * @param log get log buffer
+ * @param size log size
+ *
+ * @return get log size, the log size is less than ring buffer used size
+ */
+size_t elog_async_get_log(char *log, size_t size) {
+    return async_get_record_log(log, size, false);
+}
+#endif /* ELOG_ASYNC_LINE_OUTPUT */
+
+/* the ring and record which is got by peek */
+static AsyncRing *peek_ring = NULL;
+static uint32_t *peek_record = NULL;
+/* the log size which is got by peek */
+static size_t peek_size = 0;
+
+/**
+ * Peek the log on asynchronous output ring buffer without copy. The log can be output directly
+ * from ring buffer, then release it by @see elog_async_commit.
+ * Every record is a contiguous log, so only the first committed record log will be got and the
+ * second part is always empty.
+ *
+ * @param log1 the first part of log
+ * @param size1 the first part of log size
+ * @param log2 the second part of log
+ * @param size2 the second part of log size
+ *
+ * @return total log size
+ */
+size_t elog_async_peek(const char **log1, size_t *size1, const char **log2, size_t *size2) {
+    AsyncRing *ring = &log_ring;
+    uint32_t *record;
+    size_t log_size;
+    const char *log;
+
+    *log1 = *log2 = NULL;
+    *size1 = *size2 = 0;
+    peek_ring = NULL;
+    while (true) {
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD
+        ring = async_get_next_ring(&record, async_ring_peek_record);
+        if (!ring) {
+            break;
+        }
+#else
+        record = async_ring_peek_record(ring);
+#endif
+        if (!record) {
+            break;
+        }
+        log = async_ring_peek_record_log(ring, record, &log_size);
+        /* the deferred format log which is filtered has no log */
+        if (!log_size) {
+            async_ring_commit_record_log(ring, record, 0);
+            continue;
+        }
+        peek_ring = ring;
+        peek_record = record;
+        peek_size = log_size;
+        *log1 = log;
+        *size1 = log_size;
+        break;
+    }
+
+    return *size1;
+}
+
+/**
+ * release the log which is got by @see elog_async_peek
+ *
+ * @param size released log size, it will be limited to the peeked log size
+ */
+void elog_async_commit(size_t size) {
+    if (!peek_ring) {
+        return;
+    }
+    if (size > peek_size) {
+        size = peek_size;
+    }
+    async_ring_commit_record_log(peek_ring, peek_record, size);
+    peek_ring = NULL;
+}
+
+#ifdef ELOG_ASYNC_OUTPUT_BATCH
+/**
+ * get the first committed record after the batch position, the padding record will be skipped
+ *
+ * @param ring ring buffer
+ *
+ * @return the record header address, NULL: no committed record
+ */
+static uint32_t *async_ring_peek_batch_record(AsyncRing *ring) {
+    uint32_t *record, header;
+
+    while (ring->batch_pos != __atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE)) {
+        record = async_get_record(ring, ring->batch_pos);
+        header = __atomic_load_n(record, __ATOMIC_ACQUIRE);
+        /* the record is not committed yet */
+        if (!(header & RECORD_COMMITTED)) {
+            break;
+        }
+        if (!(header & RECORD_PADDING)) {
+            return record;
+        }
+        /* the padding record will be released with the batch */
+        ring->batch_pos += ring->size - ring->batch_pos % ring->size;
+    }
+
+    return NULL;
+}
+
+/**
+ * release the records which are got by batch
+ *
+ * @param ring ring buffer
+ */
+static void async_ring_release_batch(AsyncRing *ring) {
+    size_t pos = ring->read_pos, offset, size;
+
+    while (pos != ring->batch_pos) {
+        offset = pos % ring->size;
+        size = ring->batch_pos - pos;
+        if (offset + size > ring->size) {
+            size = ring->size - offset;
+        }
+        /* the free space must be cleared, so the stale data will not be treated as committed header */
+        memset((char *)ring->buf + offset, 0, size);
+        pos += size;
+    }
+    /* release the space for producers */
+    __atomic_store_n(&ring->read_pos, pos, __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the committed records log from lock free ring buffers without copy, every record is a
+ * log buffer vector. The records must be released by @see elog_async_release_log_vec after output.
+ *
+ * @param vec log buffer vector
+ * @param num max number of log buffer vector
+ *
+ * @return number of got log buffer vector
+ */
+size_t elog_async_get_log_vec(ElogLogVec *vec, size_t num) {
+    size_t vec_num = 0, log_size;
+    AsyncRing *ring = &log_ring;
+    uint32_t *record;
+    const char *log;
+#ifdef ELOG_ASYNC_DEFERRED_FORMAT
+    size_t deferred_batch_len = 0;
+#endif
+
+    while (vec_num < num) {
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD
+        ring = async_get_next_ring(&record, async_ring_peek_batch_record);
+        if (!ring) {
+            break;
+        }
+#else
+        record = async_ring_peek_batch_record(ring);
+#endif
+        if (!record) {
+            break;
+        }
+        log = (char *)record + RECORD_HEADER_SIZE;
+        log_size = *record & RECORD_SIZE_MASK;
+#ifdef ELOG_ASYNC_DEFERRED_FORMAT
+        if (*record & RECORD_DEFERRED) {
+            extern size_t elog_deferred_format(char *log_buf, const char *log);
+            /* the formatted logs of batch are put together, every log may use a whole line buffer */
+            if (deferred_batch_len + ELOG_LINE_BUF_SIZE > sizeof(deferred_batch_buf)) {
+                break;
+            }
+            log_size = elog_deferred_format(deferred_batch_buf + deferred_batch_len, log);
+            log = deferred_batch_buf + deferred_batch_len;
+            deferred_batch_len += log_size;
+        }
+#endif
+        ring->batch_pos += RECORD_HEADER_SIZE + RECORD_ALIGN(*record & RECORD_SIZE_MASK);
+        /* the deferred format log which is filtered has no log */
+        if (log_size) {
+            vec[vec_num].log = log;
+            vec[vec_num].size = log_size;
+            vec_num++;
+        }
+    }
+
+    return vec_num;
+}
+
+/**
+ * release the log buffer vector which is got by @see elog_async_get_log_vec
+ */
+void elog_async_release_log_vec(void) {
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD
+    size_t i;
+
+    for (i = 0; i < ELOG_ASYNC_THREAD_RING_MAX_NUM; i++) {
+        async_ring_release_batch(&thread_rings[i]);
+    }
+#endif
+    async_ring_release_batch(&log_ring);
+}
+#endif /* ELOG_ASYNC_OUTPUT_BATCH */
+
+#if defined(ELOG_ASYNC_OUTPUT_USING_PTHREAD) || defined(ELOG_ASYNC_OUTPUT_STAT_ENABLE)
+/**
+ * asynchronous output lock free ring buffers used size, it includes the record header and padding
+ *
+ * @return used size
+ */
+static size_t elog_async_get_buf_used(void) {
+    size_t used;
+
+    used = __atomic_load_n(&log_ring.write_pos, __ATOMIC_RELAXED) - __atomic_load_n(&log_ring.read_pos, __ATOMIC_RELAXED);
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD
+    size_t i;
 
-/* the highest output level for async mode, other level will sync output */
-#ifdef ELOG_ASYNC_OUTPUT_LVL
-#define OUTPUT_LVL                               ELOG_ASYNC_OUTPUT_LVL
-#else
-#define OUTPUT_LVL                               ELOG_LVL_ASSERT
-#endif /* ELOG_ASYNC_OUTPUT_LVL */
+    for (i = 0; i < ELOG_ASYNC_THREAD_RING_MAX_NUM; i++) {
+        used += __atomic_load_n(&thread_rings[i].write_pos, __ATOMIC_RELAXED)
+                - __atomic_load_n(&thread_rings[i].read_pos, __ATOMIC_RELAXED);
+    }
+#endif
 
-/* buffer size for asynchronous output mode */
-#ifdef ELOG_ASYNC_OUTPUT_BUF_SIZE
-#define OUTPUT_BUF_SIZE                          ELOG_ASYNC_OUTPUT_BUF_SIZE
+    return used;
+}
+#endif /* defined(ELOG_ASYNC_OUTPUT_USING_PTHREAD) || defined(ELOG_ASYNC_OUTPUT_STAT_ENABLE) */
+
+/**
+ * put record to asynchronous output ring buffer
+ *
+ * @param log put log buffer
+ * @param size log size
+ * @param flags record flags
+ *
+ * @return put log size, the log will be dropped when ring buffer has no enough space
+ */
+static size_t async_put_record(const char *log, size_t size, uint32_t flags) {
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD
+    AsyncRing *ring = async_get_thread_ring();
 #else
-#define OUTPUT_BUF_SIZE                          (ELOG_LINE_BUF_SIZE * 10)
-#endif /* ELOG_ASYNC_OUTPUT_BUF_SIZE */
+    AsyncRing *ring = &log_ring;
+#endif
+    size_t put_size;
 
-/* Initialize OK flag */
-static bool init_ok = false;
-/* thread running flag */
-static bool thread_running = false;
-/* asynchronous output mode enabled flag */
-static bool is_enabled = false;
+    put_size = async_ring_put_log(ring, log, size, flags);
+#if ELOG_ASYNC_OUTPUT_FULL_POLICY == ELOG_ASYNC_FULL_BLOCK
+    struct timespec start, now, interval = { 0, 100 * 1000 };
+
+    /* the log which is larger than ring buffer will never be put */
+    if (put_size || !thread_running || RECORD_HEADER_SIZE + RECORD_ALIGN(size) > ring->size) {
+        return put_size;
+    }
+    /* wait for the output thread to release the space until timeout */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        async_output_notice(true);
+        nanosleep(&interval, NULL);
+        put_size = async_ring_put_log(ring, log, size, flags);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while (!put_size && (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000
+            < ELOG_ASYNC_OUTPUT_BLOCK_TIMEOUT);
+#endif
+
+    return put_size;
+}
+
+/**
+ * put log to asynchronous output ring buffer
+ *
+ * @param log put log buffer
+ * @param size log size
+ *
+ * @return put log size, the log will be dropped when ring buffer has no enough space
+ */
+static size_t async_put_log(const char *log, size_t size) {
+    return async_put_record(log, size, 0);
+}
+
+#else
+/* total size of ring buffer */
+#define ASYNC_BUF_SIZE                           OUTPUT_BUF_SIZE
 /* asynchronous output mode's ring buffer */
 static char log_buf[OUTPUT_BUF_SIZE] = { 0 };
 /* log ring buffer write index */
@@ -95,9 +970,6 @@ static bool buf_is_full = false;
 /* log ring buffer empty flag */
 static bool buf_is_empty = true;
 
-extern void elog_port_output(const char *log, size_t size);
-extern void elog_output_lock(void);
-extern void elog_output_unlock(void);
 
 /**
  * asynchronous output ring buffer used size
@@ -127,6 +999,40 @@ static size_t async_get_buf_space(void) {
     return OUTPUT_BUF_SIZE - elog_async_get_buf_used();
 }
 
+/* the log is got by peek and it is not committed */
+static bool peek_outstanding = false;
+
+#if ELOG_ASYNC_OUTPUT_FULL_POLICY == ELOG_ASYNC_FULL_DROP_OLDEST
+/**
+ * drop the oldest line logs on asynchronous output ring buffer
+ *
+ * @param size the min drop size, all logs will be dropped when it is larger than used size
+ */
+static void async_drop_oldest_log(size_t size) {
+    size_t used = elog_async_get_buf_used(), drop_size = 0;
+    const char newline = ELOG_NEWLINE_SIGN[sizeof(ELOG_NEWLINE_SIGN) - 2];
+
+    /* the ring buffer only has line logs, so drop it until the end of line */
+    while (drop_size < used) {
+        if (log_buf[(read_index + drop_size++) % OUTPUT_BUF_SIZE] == newline) {
+#ifdef ELOG_ASYNC_OUTPUT_STAT_ENABLE
+            drop_oldest_count++;
+            drop_oldest_pending++;
+            drop_pending_total++;
+#endif
+            if (drop_size >= size) {
+                break;
+            }
+        }
+    }
+    if (drop_size == used) {
+        buf_is_empty = true;
+    }
+    read_index = (read_index + drop_size) % OUTPUT_BUF_SIZE;
+    buf_is_full = false;
+}
+#endif /* ELOG_ASYNC_OUTPUT_FULL_POLICY == ELOG_ASYNC_FULL_DROP_OLDEST */
+
 /**
  * put log to asynchronous output ring buffer
  *
@@ -139,6 +1045,20 @@ static size_t async_put_log(const char *log, size_t size) {
     size_t space = 0;
 
     space = async_get_buf_space();
+#if ELOG_ASYNC_OUTPUT_FULL_POLICY == ELOG_ASYNC_FULL_DROP_OLDEST
+    /* the log which is read by consumer can't be dropped */
+    if (space < size && size <= OUTPUT_BUF_SIZE && !peek_outstanding) {
+        async_drop_oldest_log(size - space);
+        space = async_get_buf_space();
+    }
+#endif
+#if ELOG_ASYNC_OUTPUT_FULL_POLICY != ELOG_ASYNC_FULL_TRUNCATE
+    /* drop the whole log */
+    if (space < size) {
+        size = 0;
+        goto __exit;
+    }
+#endif
     /* no space */
     if (!space) {
         size = 0;
@@ -262,41 +1182,451 @@ __exit:
 }
 #endif /* ELOG_ASYNC_LINE_OUTPUT */
 
-void elog_async_output(uint8_t level, const char *log, size_t size) {
+/**
+ * Peek the log on asynchronous output ring buffer without copy. The log can be output directly
+ * from ring buffer, then release it by @see elog_async_commit.
+ * The log is divided into two parts when it wraps around the end of ring buffer.
+ *
+ * @param log1 the first part of log
+ * @param size1 the first part of log size
+ * @param log2 the second part of log
+ * @param size2 the second part of log size
+ *
+ * @return total log size
+ */
+size_t elog_async_peek(const char **log1, size_t *size1, const char **log2, size_t *size2) {
+    size_t used = 0;
+    /* lock output */
+    elog_output_lock();
+    used = elog_async_get_buf_used();
+    peek_outstanding = used > 0;
+    /* lock output */
+    elog_output_unlock();
+
+    *log1 = *log2 = NULL;
+    *size1 = *size2 = 0;
+    /* no log */
+    if (!used) {
+        return 0;
+    }
+    /* the producer only writes the free space, so the used space can be read without lock */
+    *log1 = log_buf + read_index;
+    if (read_index + used <= OUTPUT_BUF_SIZE) {
+        *size1 = used;
+    } else {
+        *size1 = OUTPUT_BUF_SIZE - read_index;
+        *log2 = log_buf;
+        *size2 = used - *size1;
+    }
+
+    return used;
+}
+
+/**
+ * release the log which is got by @see elog_async_peek
+ *
+ * @param size released log size, it will be limited to the ring buffer used size
+ */
+void elog_async_commit(size_t size) {
+    size_t used = 0;
+    /* lock output */
+    elog_output_lock();
+    used = elog_async_get_buf_used();
+    if (size > used) {
+        size = used;
+    }
+    if (!size) {
+        goto __exit;
+    }
+    if (size == used) {
+        buf_is_empty = true;
+    }
+    read_index = (read_index + size) % OUTPUT_BUF_SIZE;
+    buf_is_full = false;
+
+__exit:
+    peek_outstanding = false;
+    /* lock output */
+    elog_output_unlock();
+}
+
+#ifdef ELOG_ASYNC_OUTPUT_BATCH
+/* the log size which is got by batch */
+static size_t batch_size = 0;
+
+/**
+ * Get the log from asynchronous output ring buffer without copy, the log is divided into two
+ * log buffer vectors when it wraps around. The log must be released by
+ * @see elog_async_release_log_vec after output.
+ *
+ * @param vec log buffer vector
+ * @param num max number of log buffer vector
+ *
+ * @return number of got log buffer vector
+ */
+size_t elog_async_get_log_vec(ElogLogVec *vec, size_t num) {
+    const char *log2;
+    size_t size2;
+
+    batch_size = 0;
+    if (!num || !elog_async_peek(&vec[0].log, &vec[0].size, &log2, &size2)) {
+        return 0;
+    }
+    batch_size = vec[0].size;
+    if (size2 && num > 1) {
+        vec[1].log = log2;
+        vec[1].size = size2;
+        batch_size += size2;
+        return 2;
+    }
+
+    return 1;
+}
+
+/**
+ * release the log buffer vector which is got by @see elog_async_get_log_vec
+ */
+void elog_async_release_log_vec(void) {
+    elog_async_commit(batch_size);
+    batch_size = 0;
+}
+#endif /* ELOG_ASYNC_OUTPUT_BATCH */
+#endif /* ELOG_ASYNC_OUTPUT_LOCK_FREE */
+
+#ifdef ELOG_ASYNC_OUTPUT_STAT_ENABLE
+/**
+ * count the dropped log
+ *
+ * @param level dropped log level
+ */
+static void async_stat_drop(uint8_t level) {
+    stat_add(drop_count[level], 1);
+    stat_add(drop_pending[level], 1);
+    stat_add(drop_pending_total, 1);
+}
+
+/**
+ * put a summary log of the dropped logs which are not reported, such as:
+ * "EasyLogger dropped 1234 logs (56 ERROR, 1178 VERBOSE)"
+ */
+static void async_put_drop_summary(void) {
+    static const char *level_name[] = { "ASSERT", "ERROR", "WARN", "INFO", "DEBUG", "VERBOSE" };
+    size_t pending[ELOG_LVL_TOTAL_NUM], oldest_pending, total = 0, len, i;
+    /* every count has 20 digits at most, the longest name is "VERBOSE" */
+    char summary[sizeof("EasyLogger dropped 18446744073709551615 logs (")
+            + (ELOG_LVL_TOTAL_NUM + 1) * sizeof("18446744073709551615 VERBOSE, ") + sizeof(ELOG_NEWLINE_SIGN)];
+
+    for (i = 0; i < ELOG_LVL_TOTAL_NUM; i++) {
+        pending[i] = stat_exchange(drop_pending[i], 0);
+        total += pending[i];
+    }
+    oldest_pending = stat_exchange(drop_oldest_pending, 0);
+    total += oldest_pending;
+    stat_sub(drop_pending_total, total);
+    if (!total) {
+        return;
+    }
+    len = snprintf(summary, sizeof(summary), "EasyLogger dropped %lu logs (", (unsigned long) total);
+    for (i = 0; i < ELOG_LVL_TOTAL_NUM && len < sizeof(summary); i++) {
+        if (pending[i]) {
+            len += snprintf(summary + len, sizeof(summary) - len, "%lu %s, ", (unsigned long) pending[i],
+                    level_name[i]);
+        }
+    }
+    if (oldest_pending && len < sizeof(summary)) {
+        len += snprintf(summary + len, sizeof(summary) - len, "%lu OLDEST, ", (unsigned long) oldest_pending);
+    }
+    if (len >= sizeof(summary)) {
+        len = sizeof(summary) - 1;
+    }
+    /* replace the last ", " */
+    if (len >= 2 && summary[len - 2] == ',') {
+        len -= 2;
+    }
+    len += snprintf(summary + len, sizeof(summary) - len, ")" ELOG_NEWLINE_SIGN);
+    if (len >= sizeof(summary)) {
+        len = sizeof(summary) - 1;
+    }
+
+    /* the summary will be put again next time when it is dropped */
+    if (!async_put_log(summary, len)) {
+        for (i = 0; i < ELOG_LVL_TOTAL_NUM; i++) {
+            stat_add(drop_pending[i], pending[i]);
+        }
+        stat_add(drop_oldest_pending, oldest_pending);
+        stat_add(drop_pending_total, total);
+    }
+}
+
+/**
+ * update the statistics after the log is put, the drop summary log will be put when the
+ * ring buffer has enough space again
+ */
+static void async_stat_put(void) {
+    size_t used = elog_async_get_buf_used();
+
+    stat_update_max(buf_used_max, used);
+    /* the ring buffer is still busy, or another producer is putting the summary */
+    if (!stat_load(drop_pending_total) || used > ASYNC_BUF_SIZE / 2 || !drop_summary_trylock()) {
+        return;
+    }
+    async_put_drop_summary();
+    drop_summary_unlock();
+}
+
+/**
+ * get the asynchronous output statistics
+ *
+ * @param stat statistics
+ */
+void elog_async_get_stat(ElogAsyncStat *stat) {
+    size_t i;
+
+    ELOG_ASSERT(stat);
+
+    for (i = 0; i < ELOG_LVL_TOTAL_NUM; i++) {
+        stat->dropped[i] = stat_load(drop_count[i]);
+    }
+    stat->dropped_oldest = stat_load(drop_oldest_count);
+    stat->buf_size = ASYNC_BUF_SIZE;
+    stat->buf_used_max = stat_load(buf_used_max);
+}
+
+/**
+ * clear the dropped log count and the max used size of ring buffer
+ */
+void elog_async_clear_stat(void) {
+    size_t i;
+
+    for (i = 0; i < ELOG_LVL_TOTAL_NUM; i++) {
+        stat_store(drop_count[i], 0);
+    }
+    stat_store(drop_oldest_count, 0);
+    stat_store(buf_used_max, 0);
+}
+#endif /* ELOG_ASYNC_OUTPUT_STAT_ENABLE */
+
+/**
+ * output log to port directly
+ *
+ * @param level log level
+ * @param log log buffer
+ * @param size log size
+ */
+static void async_port_output(uint8_t level, const char *log, size_t size) {
+#ifdef ELOG_ASYNC_OUTPUT_LOCK_FREE
+    /* the caller doesn't hold the output lock when using lock free ring buffer */
+    elog_output_lock();
+    elog_port_output(log, size);
+    port_output_flush(level);
+    elog_output_unlock();
+#else
+    elog_port_output(log, size);
+    port_output_flush(level);
+#endif
+}
+
+/**
+ * notify output log thread after the log is put to ring buffer
+ *
+ * @param full true: the ring buffer is full, the output thread will be woken up even the watermark is not reached
+ */
+static void async_output_notice(bool full) {
     /* this function must be implement by user when ELOG_ASYNC_OUTPUT_USING_PTHREAD is not defined */
     extern void elog_async_output_notice(void);
+#ifdef ELOG_ASYNC_OUTPUT_USING_PTHREAD
+    int state;
+
+    /* the put log must be visible before checking the state, it pairs with the fence in output thread */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    state = __atomic_load_n(&output_thread_state, __ATOMIC_RELAXED);
+    /* the running output thread will get the log before waiting */
+    if (state == OUTPUT_THREAD_RUNNING) {
+        return;
+    }
+#if ELOG_ASYNC_OUTPUT_WAKEUP_WATERMARK > 0
+    if (!full && state == OUTPUT_THREAD_BATCHING && elog_async_get_buf_used() < ELOG_ASYNC_OUTPUT_WAKEUP_WATERMARK) {
+        return;
+    }
+#else
+    (void) full;
+#endif
+    /* only one producer notices the output thread */
+    if (__atomic_compare_exchange_n(&output_thread_state, &state, OUTPUT_THREAD_RUNNING, false, __ATOMIC_ACQ_REL,
+            __ATOMIC_RELAXED)) {
+        elog_async_output_notice();
+    }
+#else
+    (void) full;
+    elog_async_output_notice();
+#endif /* ELOG_ASYNC_OUTPUT_USING_PTHREAD */
+}
+
+void elog_async_output(uint8_t level, const char *log, size_t size) {
     size_t put_size;
 
     if (is_enabled) {
         if (level >= OUTPUT_LVL) {
             put_size = async_put_log(log, size);
+#ifdef ELOG_ASYNC_OUTPUT_STAT_ENABLE
+            if (put_size > 0) {
+                async_stat_put();
+            }
+#endif
             /* notify output log thread */
             if (put_size > 0) {
-                elog_async_output_notice();
+                output_flush_request(level);
+                async_output_notice(false);
+            }
+#ifdef ELOG_ASYNC_OUTPUT_FULL_SYNC_LVL
+            /* the high level log which is dropped will be output directly */
+            else if (level <= ELOG_ASYNC_OUTPUT_FULL_SYNC_LVL) {
+                async_port_output(level, log, size);
+                return;
+            }
+#endif
+#ifdef ELOG_ASYNC_OUTPUT_STAT_ENABLE
+            /* the log is dropped or truncated */
+            if (put_size < size) {
+                async_stat_drop(level);
             }
+#endif
         } else {
-            elog_port_output(log, size);
+            async_port_output(level, log, size);
         }
     } else {
-        elog_port_output(log, size);
+        async_port_output(level, log, size);
+    }
+}
+
+#ifdef ELOG_ASYNC_DEFERRED_FORMAT
+/**
+ * the log which is output asynchronously will be formatted on asynchronous output thread
+ *
+ * @param level level
+ *
+ * @return true: the log will be deferred format
+ */
+bool elog_async_is_deferred(uint8_t level) {
+#ifdef ELOG_ASYNC_OUTPUT_FULL_SYNC_LVL
+    /* the deferred format log can't be output directly when it is dropped */
+    if (level <= ELOG_ASYNC_OUTPUT_FULL_SYNC_LVL) {
+        return false;
+    }
+#endif
+    return is_enabled && level >= OUTPUT_LVL;
+}
+
+/**
+ * put the deferred format log to asynchronous output ring buffer
+ *
+ * @param log deferred format log
+ * @param size deferred format log size
+ */
+void elog_async_deferred_output(uint8_t level, const char *log, size_t size) {
+    if (async_put_record(log, size, RECORD_DEFERRED) > 0) {
+#ifdef ELOG_ASYNC_OUTPUT_STAT_ENABLE
+        async_stat_put();
+#endif
+        output_flush_request(level);
+        async_output_notice(false);
+    }
+#ifdef ELOG_ASYNC_OUTPUT_STAT_ENABLE
+    else {
+        async_stat_drop(level);
     }
+#endif
 }
+#endif /* ELOG_ASYNC_DEFERRED_FORMAT */
 
 #ifdef ELOG_ASYNC_OUTPUT_USING_PTHREAD
 void elog_async_output_notice(void) {
     sem_post(&output_notice);
 }
 
+/**
+ * Output thread waits for the log. It waits until noticed when there is no log, or waits for
+ * more log until the watermark is reached or timeout when the log is less than the watermark.
+ */
+static void async_output_wait(void) {
+    size_t used;
+
+    __atomic_store_n(&output_thread_state, OUTPUT_THREAD_WAITING, __ATOMIC_RELAXED);
+    /* the state must be visible before checking the log, it pairs with the fence in producer */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#ifdef ELOG_ASYNC_OUTPUT_LOCK_FREE
+    used = elog_async_get_buf_used();
+#else
+    elog_output_lock();
+    used = elog_async_get_buf_used();
+    elog_output_unlock();
+#endif
+
+    if (!used) {
+        sem_wait(&output_notice);
+    }
+#if ELOG_ASYNC_OUTPUT_WAKEUP_WATERMARK > 0
+    else if (used < ELOG_ASYNC_OUTPUT_WAKEUP_WATERMARK) {
+        int state = OUTPUT_THREAD_WAITING;
+        struct timespec timeout;
+
+        if (__atomic_compare_exchange_n(&output_thread_state, &state, OUTPUT_THREAD_BATCHING, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_nsec += (ELOG_ASYNC_OUTPUT_WAKEUP_TIMEOUT % 1000) * 1000000L;
+            timeout.tv_sec += ELOG_ASYNC_OUTPUT_WAKEUP_TIMEOUT / 1000 + timeout.tv_nsec / 1000000000L;
+            timeout.tv_nsec %= 1000000000L;
+            sem_timedwait(&output_notice, &timeout);
+        } else {
+            /* it has been noticed by producer */
+            sem_wait(&output_notice);
+        }
+    }
+#endif
+
+    __atomic_store_n(&output_thread_state, OUTPUT_THREAD_RUNNING, __ATOMIC_RELAXED);
+}
+
 static void *async_output(void *arg) {
+#ifdef ELOG_ASYNC_OUTPUT_BATCH
+    /* this function must be implement by user when ELOG_ASYNC_OUTPUT_BATCH is defined */
+    extern void elog_port_output_vec(const ElogLogVec *vec, size_t num);
+    size_t get_vec_num = 0;
+    static ElogLogVec poll_get_vec[ELOG_ASYNC_OUTPUT_BATCH_MAX_NUM];
+#elif defined(ELOG_ASYNC_OUTPUT_LOCK_FREE) || defined(ELOG_ASYNC_LINE_OUTPUT) \
+        || ELOG_ASYNC_OUTPUT_FULL_POLICY == ELOG_ASYNC_FULL_DROP_OLDEST
     size_t get_log_size = 0;
     static char poll_get_buf[ELOG_ASYNC_POLL_GET_LOG_BUF_SIZE];
+#else
+    const char *peek_log1, *peek_log2;
+    size_t peek_size1, peek_size2;
+#endif
+#ifdef ELOG_OUTPUT_FLUSH_LVL
+    bool flush = false;
+#endif
 
     while(thread_running) {
         /* waiting log */
-        sem_wait(&output_notice);
+        async_output_wait();
         /* polling gets and outputs the log */
         while(true) {
+#ifdef ELOG_OUTPUT_FLUSH_LVL
+            /* the high level log is put before the request, so it will be output in this polling */
+            flush = __atomic_exchange_n(&output_flush_pending, false, __ATOMIC_ACQUIRE) || flush;
+#endif
 
+#ifdef ELOG_ASYNC_OUTPUT_BATCH
+            /* output all logs on ring buffer by one port output */
+            get_vec_num = elog_async_get_log_vec(poll_get_vec, ELOG_ASYNC_OUTPUT_BATCH_MAX_NUM);
+            if (get_vec_num) {
+                elog_port_output_vec(poll_get_vec, get_vec_num);
+            }
+            elog_async_release_log_vec();
+            if (!get_vec_num) {
+                break;
+            }
+#elif defined(ELOG_ASYNC_OUTPUT_LOCK_FREE) || defined(ELOG_ASYNC_LINE_OUTPUT) \
+        || ELOG_ASYNC_OUTPUT_FULL_POLICY == ELOG_ASYNC_FULL_DROP_OLDEST
 #ifdef ELOG_ASYNC_LINE_OUTPUT
             get_log_size = elog_async_get_line_log(poll_get_buf, ELOG_ASYNC_POLL_GET_LOG_BUF_SIZE);
 #else
@@ -308,7 +1638,24 @@ static void *async_output(void *arg) {
             } else {
                 break;
             }
+#else
+            /* output the log from ring buffer directly */
+            if (!elog_async_peek(&peek_log1, &peek_size1, &peek_log2, &peek_size2)) {
+                break;
+            }
+            elog_port_output(peek_log1, peek_size1);
+            if (peek_size2) {
+                elog_port_output(peek_log2, peek_size2);
+            }
+            elog_async_commit(peek_size1 + peek_size2);
+#endif /* ELOG_ASYNC_OUTPUT_BATCH */
+        }
+#ifdef ELOG_OUTPUT_FLUSH_LVL
+        if (flush) {
+            flush = false;
+            elog_port_output_flush();
         }
+#endif
     }
     return NULL;
 }
@@ -336,6 +1683,19 @@ ElogErrCode elog_async_init(void) {
         return result;
     }
 
+#ifdef ELOG_ASYNC_OUTPUT_PER_THREAD
+    size_t i;
+
+    for (i = 0; i < ELOG_ASYNC_THREAD_RING_MAX_NUM; i++) {
+        thread_rings[i].buf = thread_ring_buf[i];
+        thread_rings[i].size = THREAD_RING_BUF_SIZE;
+        thread_rings[i].single_producer = true;
+    }
+#ifdef ELOG_ASYNC_OUTPUT_USING_PTHREAD
+    pthread_key_create(&thread_ring_key, async_thread_ring_release);
+#endif
+#endif /* ELOG_ASYNC_OUTPUT_PER_THREAD */
+
 #ifdef ELOG_ASYNC_OUTPUT_USING_PTHREAD
     pthread_attr_t thread_attr;
     struct sched_param thread_sched_param;
@@ -378,6 +1738,10 @@ void elog_async_deinit(void) {
     sem_destroy(&output_notice);
 #endif
 
+#if defined(ELOG_ASYNC_OUTPUT_PER_THREAD) && defined(ELOG_ASYNC_OUTPUT_USING_PTHREAD)
+    pthread_key_delete(thread_ring_key);
+#endif
+
     init_ok = false;
 }
 
@@ -28,6 +28,8 @@
 
 #include <elog.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
 
 /**
  * another copy string function
@@ -39,20 +41,34 @@
  * @return copied length
  */
 size_t elog_strcpy(size_t cur_len, char *dst, const char *src) {
-    const char *src_old = src;
+    assert(src);
+
+    return elog_strncpy(cur_len, dst, src, strlen(src));
+}
 
+/**
+ * copy the string which length is known, it is faster than elog_strcpy
+ *
+ * @param cur_len current copied log length, max size is ELOG_LINE_BUF_SIZE
+ * @param dst destination
+ * @param src source
+ * @param len source length
+ *
+ * @return copied length
+ */
+size_t elog_strncpy(size_t cur_len, char *dst, const char *src, size_t len) {
     assert(dst);
     assert(src);
 
-    while (*src != 0) {
-        /* make sure destination has enough space */
-        if (cur_len++ < ELOG_LINE_BUF_SIZE) {
-            *dst++ = *src++;
-        } else {
-            break;
-        }
+    /* make sure destination has enough space */
+    if (cur_len >= ELOG_LINE_BUF_SIZE) {
+        return 0;
+    } else if (len > ELOG_LINE_BUF_SIZE - cur_len) {
+        len = ELOG_LINE_BUF_SIZE - cur_len;
     }
-    return src - src_old;
+    memcpy(dst, src, len);
+
+    return len;
 }
 
 /**
@@ -65,18 +81,30 @@ size_t elog_strcpy(size_t cur_len, char *dst, const char *src) {
  * @return copy size
  */
 size_t elog_cpyln(char *line, const char *log, size_t len) {
-    size_t newline_len = strlen(ELOG_NEWLINE_SIGN), copy_size = 0;
+    size_t newline_len = sizeof(ELOG_NEWLINE_SIGN) - 1, copy_size = len;
+    const char *pos = log, *end = log + len;
 
     assert(line);
     assert(log);
 
-    while (len--) {
-        *line++ = *log++;
-        copy_size++;
-        if (copy_size >= newline_len && !strncmp(log - newline_len, ELOG_NEWLINE_SIGN, newline_len)) {
-            break;
+    if (newline_len == 1) {
+        /* the single char newline sign, such as "\n" */
+        pos = memchr(log, ELOG_NEWLINE_SIGN[0], len);
+        if (pos) {
+            copy_size = pos - log + 1;
+        }
+    } else {
+        /* find the last char of newline sign, then compare the whole newline sign */
+        while ((pos = memchr(pos, ELOG_NEWLINE_SIGN[newline_len - 1], end - pos)) != NULL) {
+            pos++;
+            if ((size_t) (pos - log) >= newline_len && !memcmp(pos - newline_len, ELOG_NEWLINE_SIGN, newline_len)) {
+                copy_size = pos - log;
+                break;
+            }
         }
     }
+    memcpy(line, log, copy_size);
+
     return copy_size;
 }
 
@@ -101,3 +129,418 @@ void *elog_memcpy(void *dst, const void *src, size_t count) {
 
     return dst;
 }
+
+#if defined(ELOG_ASYNC_DEFERRED_FORMAT) || defined(ELOG_TOKENIZE_ENABLE)
+/* conversion specification's length modifier */
+typedef enum {
+    ARG_LEN_NONE,
+    ARG_LEN_HH,
+    ARG_LEN_H,
+    ARG_LEN_L,
+    ARG_LEN_LL,
+    ARG_LEN_J,
+    ARG_LEN_Z,
+    ARG_LEN_T,
+    ARG_LEN_BIG_L,
+} ElogArgLen;
+
+/* conversion specification, such as: %-08.3lld */
+typedef struct {
+    char flags[8];
+    /* -1: no width, -2: width is an argument */
+    int width;
+    /* -1: no precision, -2: precision is an argument */
+    int precision;
+    ElogArgLen len;
+    char conv;
+} ElogArgSpec;
+
+/**
+ * parse the conversion specification
+ *
+ * @param format the format after '%'
+ * @param spec parsed specification
+ *
+ * @return the format after the conversion specification, NULL: parse failed
+ */
+static const char *args_parse_spec(const char *format, ElogArgSpec *spec) {
+    size_t flags_len = 0;
+
+    memset(spec, 0, sizeof(ElogArgSpec));
+    /* flags */
+    while (*format != '\0' && strchr("-+ #0", *format)) {
+        if (flags_len < sizeof(spec->flags) - 1) {
+            spec->flags[flags_len++] = *format;
+        }
+        format++;
+    }
+    /* width */
+    spec->width = -1;
+    if (*format == '*') {
+        spec->width = -2;
+        format++;
+    } else if (*format >= '0' && *format <= '9') {
+        spec->width = 0;
+        while (*format >= '0' && *format <= '9') {
+            spec->width = spec->width * 10 + (*format++ - '0');
+        }
+    }
+    /* precision */
+    spec->precision = -1;
+    if (*format == '.') {
+        format++;
+        spec->precision = 0;
+        if (*format == '*') {
+            spec->precision = -2;
+            format++;
+        } else {
+            while (*format >= '0' && *format <= '9') {
+                spec->precision = spec->precision * 10 + (*format++ - '0');
+            }
+        }
+    }
+    /* length modifier */
+    switch (*format) {
+    case 'h':
+        spec->len = (*(format + 1) == 'h') ? ARG_LEN_HH : ARG_LEN_H;
+        format += (spec->len == ARG_LEN_HH) ? 2 : 1;
+        break;
+    case 'l':
+        spec->len = (*(format + 1) == 'l') ? ARG_LEN_LL : ARG_LEN_L;
+        format += (spec->len == ARG_LEN_LL) ? 2 : 1;
+        break;
+    case 'j': spec->len = ARG_LEN_J; format++; break;
+    case 'z': spec->len = ARG_LEN_Z; format++; break;
+    case 't': spec->len = ARG_LEN_T; format++; break;
+    case 'L': spec->len = ARG_LEN_BIG_L; format++; break;
+    default: break;
+    }
+    /* conversion */
+    if (*format == '\0' || !strchr("diuoxXcspfFeEgGaA%", *format)) {
+        return NULL;
+    }
+    /* the wide character and string are not supported */
+    if ((*format == 'c' || *format == 's') && spec->len != ARG_LEN_NONE) {
+        return NULL;
+    }
+    spec->conv = *format++;
+
+    return format;
+}
+
+/**
+ * put the argument to pack buffer
+ *
+ * @param buf pack buffer
+ * @param size pack buffer size
+ * @param pack_len current packed length
+ * @param arg argument
+ * @param arg_size argument size
+ *
+ * @return true: put success, false: the buffer has no enough space
+ */
+static bool args_pack_put(char *buf, size_t size, size_t *pack_len, const void *arg, size_t arg_size) {
+    if (*pack_len + arg_size > size) {
+        return false;
+    }
+    memcpy(buf + *pack_len, arg, arg_size);
+    *pack_len += arg_size;
+    return true;
+}
+
+/**
+ * Pack the arguments of format to buffer, the arguments will be formatted later by
+ * @see elog_args_snprintf. The string argument will be copied, the part of string will be
+ * copied when buffer has no enough space.
+ *
+ * @param buf pack buffer
+ * @param size pack buffer size
+ * @param format output format
+ * @param args arguments
+ *
+ * @return packed size, 0: the format is not supported or buffer has no enough space
+ */
+size_t elog_args_pack(char *buf, size_t size, const char *format, va_list args) {
+    ElogArgSpec spec;
+    size_t pack_len = 0, str_len;
+    long long sval;
+    unsigned long long uval;
+    int ival, precision;
+    double dval;
+    long double ldval;
+    void *pval;
+    const char *str, *str_end;
+
+    assert(buf);
+    assert(format);
+
+    while ((format = strchr(format, '%')) != NULL) {
+        if ((format = args_parse_spec(format + 1, &spec)) == NULL) {
+            return 0;
+        }
+        if (spec.width == -2) {
+            ival = va_arg(args, int);
+            if (!args_pack_put(buf, size, &pack_len, &ival, sizeof(ival))) {
+                return 0;
+            }
+        }
+        precision = spec.precision;
+        if (spec.precision == -2) {
+            ival = va_arg(args, int);
+            if (!args_pack_put(buf, size, &pack_len, &ival, sizeof(ival))) {
+                return 0;
+            }
+            /* the negative precision argument is taken as if the precision were omitted */
+            precision = ival;
+        }
+        switch (spec.conv) {
+        case 'd':
+        case 'i':
+            switch (spec.len) {
+            case ARG_LEN_HH: sval = (signed char) va_arg(args, int); break;
+            case ARG_LEN_H: sval = (short) va_arg(args, int); break;
+            case ARG_LEN_L: sval = va_arg(args, long); break;
+            case ARG_LEN_LL: sval = va_arg(args, long long); break;
+            case ARG_LEN_J: sval = va_arg(args, intmax_t); break;
+            case ARG_LEN_Z: sval = (long long) va_arg(args, size_t); break;
+            case ARG_LEN_T: sval = va_arg(args, ptrdiff_t); break;
+            default: sval = va_arg(args, int); break;
+            }
+            if (!args_pack_put(buf, size, &pack_len, &sval, sizeof(sval))) {
+                return 0;
+            }
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            switch (spec.len) {
+            case ARG_LEN_HH: uval = (unsigned char) va_arg(args, unsigned int); break;
+            case ARG_LEN_H: uval = (unsigned short) va_arg(args, unsigned int); break;
+            case ARG_LEN_L: uval = va_arg(args, unsigned long); break;
+            case ARG_LEN_LL: uval = va_arg(args, unsigned long long); break;
+            case ARG_LEN_J: uval = va_arg(args, uintmax_t); break;
+            case ARG_LEN_Z: uval = va_arg(args, size_t); break;
+            case ARG_LEN_T: uval = (unsigned long long) va_arg(args, ptrdiff_t); break;
+            default: uval = va_arg(args, unsigned int); break;
+            }
+            if (!args_pack_put(buf, size, &pack_len, &uval, sizeof(uval))) {
+                return 0;
+            }
+            break;
+        case 'c':
+            ival = va_arg(args, int);
+            if (!args_pack_put(buf, size, &pack_len, &ival, sizeof(ival))) {
+                return 0;
+            }
+            break;
+        case 's':
+            str = va_arg(args, const char *);
+            if (str == NULL) {
+                str = "(null)";
+            }
+            /* the string which has precision may be not terminated, so only the precision length is read */
+            if (precision >= 0) {
+                str_end = memchr(str, '\0', precision);
+                str_len = str_end ? (size_t) (str_end - str) : (size_t) precision;
+            } else {
+                str_len = strlen(str);
+            }
+            /* copy the part of string when buffer has no enough space */
+            if (pack_len + str_len + 1 > size) {
+                if (pack_len + 1 > size) {
+                    return 0;
+                }
+                str_len = size - pack_len - 1;
+            }
+            memcpy(buf + pack_len, str, str_len);
+            buf[pack_len + str_len] = '\0';
+            pack_len += str_len + 1;
+            break;
+        case 'p':
+            pval = va_arg(args, void *);
+            if (!args_pack_put(buf, size, &pack_len, &pval, sizeof(pval))) {
+                return 0;
+            }
+            break;
+        case '%':
+            break;
+        default:
+            if (spec.len == ARG_LEN_BIG_L) {
+                ldval = va_arg(args, long double);
+                if (!args_pack_put(buf, size, &pack_len, &ldval, sizeof(ldval))) {
+                    return 0;
+                }
+            } else {
+                dval = va_arg(args, double);
+                if (!args_pack_put(buf, size, &pack_len, &dval, sizeof(dval))) {
+                    return 0;
+                }
+            }
+            break;
+        }
+    }
+    /* the format which has no argument also need a non-zero packed size */
+    if (pack_len == 0) {
+        if (size == 0) {
+            return 0;
+        }
+        buf[pack_len++] = '\0';
+    }
+
+    return pack_len;
+}
+
+/**
+ * get the argument from pack buffer
+ *
+ * @param args pack buffer
+ * @param arg argument
+ * @param arg_size argument size
+ *
+ * @return the pack buffer after the argument
+ */
+static const char *args_pack_get(const char *args, void *arg, size_t arg_size) {
+    memcpy(arg, args, arg_size);
+    return args + arg_size;
+}
+
+/**
+ * output the formatted string to buffer, it has the same return value as snprintf
+ */
+#define ARGS_SNPRINTF(...)                                                                          \
+    do {                                                                                            \
+        fmt_result = snprintf(out_len < size ? buf + out_len : NULL, out_len < size ? size - out_len : 0, \
+                __VA_ARGS__);                                                                       \
+        if (fmt_result < 0) {                                                                       \
+            return fmt_result;                                                                      \
+        }                                                                                           \
+        out_len += fmt_result;                                                                      \
+    } while (0)
+
+/**
+ * Format the packed arguments to buffer. It is same as vsnprintf, but the arguments
+ * are packed by @see elog_args_pack.
+ *
+ * @param buf output buffer
+ * @param size output buffer size
+ * @param format output format
+ * @param args packed arguments
+ *
+ * @return the formatted length, it is same as vsnprintf
+ */
+int elog_args_snprintf(char *buf, size_t size, const char *format, const char *args) {
+    ElogArgSpec spec;
+    size_t out_len = 0, literal_len;
+    const char *spec_start;
+    char spec_fmt[48], *spec_fmt_end;
+    int fmt_result, width, precision;
+    long long sval;
+    unsigned long long uval;
+    int ival;
+    double dval;
+    long double ldval;
+    void *pval;
+
+    assert(buf);
+    assert(format);
+    assert(args);
+
+    while (*format != '\0') {
+        /* output the literal string */
+        if ((spec_start = strchr(format, '%')) == NULL) {
+            spec_start = format + strlen(format);
+        }
+        literal_len = spec_start - format;
+        if (out_len < size) {
+            memcpy(buf + out_len, format, out_len + literal_len < size ? literal_len : size - out_len);
+        }
+        out_len += literal_len;
+        if (*spec_start == '\0') {
+            break;
+        }
+        format = args_parse_spec(spec_start + 1, &spec);
+        /* it has been checked by elog_args_pack */
+        assert(format);
+        /* rebuild the specification, the width and precision argument will be expanded */
+        width = spec.width;
+        precision = spec.precision;
+        if (width == -2) {
+            args = args_pack_get(args, &width, sizeof(width));
+        }
+        if (precision == -2) {
+            args = args_pack_get(args, &precision, sizeof(precision));
+        }
+        spec_fmt_end = spec_fmt + snprintf(spec_fmt, sizeof(spec_fmt) - 4, "%%%s", spec.flags);
+        if (width != -1) {
+            spec_fmt_end += snprintf(spec_fmt_end, spec_fmt + sizeof(spec_fmt) - 4 - spec_fmt_end, "%d", width);
+        }
+        if (precision >= 0) {
+            spec_fmt_end += snprintf(spec_fmt_end, spec_fmt + sizeof(spec_fmt) - 4 - spec_fmt_end, ".%d", precision);
+        }
+        switch (spec.conv) {
+        case 'd':
+        case 'i':
+            args = args_pack_get(args, &sval, sizeof(sval));
+            *spec_fmt_end++ = 'l';
+            *spec_fmt_end++ = 'l';
+            *spec_fmt_end++ = spec.conv;
+            *spec_fmt_end = '\0';
+            ARGS_SNPRINTF(spec_fmt, sval);
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            args = args_pack_get(args, &uval, sizeof(uval));
+            *spec_fmt_end++ = 'l';
+            *spec_fmt_end++ = 'l';
+            *spec_fmt_end++ = spec.conv;
+            *spec_fmt_end = '\0';
+            ARGS_SNPRINTF(spec_fmt, uval);
+            break;
+        case 'c':
+            args = args_pack_get(args, &ival, sizeof(ival));
+            *spec_fmt_end++ = spec.conv;
+            *spec_fmt_end = '\0';
+            ARGS_SNPRINTF(spec_fmt, ival);
+            break;
+        case 's':
+            *spec_fmt_end++ = spec.conv;
+            *spec_fmt_end = '\0';
+            ARGS_SNPRINTF(spec_fmt, args);
+            args += strlen(args) + 1;
+            break;
+        case 'p':
+            args = args_pack_get(args, &pval, sizeof(pval));
+            *spec_fmt_end++ = spec.conv;
+            *spec_fmt_end = '\0';
+            ARGS_SNPRINTF(spec_fmt, pval);
+            break;
+        case '%':
+            ARGS_SNPRINTF("%%");
+            break;
+        default:
+            if (spec.len == ARG_LEN_BIG_L) {
+                args = args_pack_get(args, &ldval, sizeof(ldval));
+                *spec_fmt_end++ = 'L';
+                *spec_fmt_end++ = spec.conv;
+                *spec_fmt_end = '\0';
+                ARGS_SNPRINTF(spec_fmt, ldval);
+            } else {
+                args = args_pack_get(args, &dval, sizeof(dval));
+                *spec_fmt_end++ = spec.conv;
+                *spec_fmt_end = '\0';
+                ARGS_SNPRINTF(spec_fmt, dval);
+            }
+            break;
+        }
+    }
+    /* add string end sign */
+    if (size) {
+        buf[out_len < size ? out_len : size - 1] = '\0';
+    }
+
+    return (int) out_len;
+}
+#endif /* defined(ELOG_ASYNC_DEFERRED_FORMAT) || defined(ELOG_TOKENIZE_ENABLE) */
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#
+# This file is part of the EasyLogger Library.
+#
+# Decode the tokenized log (ELOG_TOKENIZE_ENABLE) to text log on host.
+#
+# Usage:
+#   python3 elog_token_decode.py <firmware.elf | elog_token.bin> [log file, default: stdin]
+#
+# The token table is the elog_token section of firmware, it can be read from the ELF file directly
+# or dumped by: objcopy -O binary --only-section=elog_token firmware.elf elog_token.bin
+#
+# The frame is: sync byte(0xE7) + arguments length(2 bytes) + token ID(4 bytes) + packed arguments.
+# The token ID is the offset of the token in elog_token section. The other bytes which are not frame
+# will be output as they are.
+
+import argparse
+import re
+import struct
+import sys
+
+TOKEN_SYNC = 0xE7
+TOKEN_HEAD_LEN = 7
+TOKEN_SECTION = b'elog_token'
+LEVEL_INFO = ['A', 'E', 'W', 'I', 'D', 'V']
+# same as the conversion specification of elog_args_pack
+SPEC_PATTERN = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?([diuoxXcspfFeEgGaA%])')
+
+
+def read_elf_section(data, name):
+    """read the section data by name from ELF file"""
+    is_64 = data[4] == 2
+    endian = '<' if data[5] == 1 else '>'
+    if is_64:
+        shoff, = struct.unpack_from(endian + 'Q', data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', data, 0x3A)
+        sh_fmt = endian + 'IIQQQQ'
+    else:
+        shoff, = struct.unpack_from(endian + 'I', data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', data, 0x2E)
+        sh_fmt = endian + 'IIIIII'
+    sections = [struct.unpack_from(sh_fmt, data, shoff + i * shentsize) for i in range(shnum)]
+    str_offset, str_size = sections[shstrndx][4], sections[shstrndx][5]
+    strtab = data[str_offset:str_offset + str_size]
+    for sh_name, sh_type, _, _, sh_offset, sh_size in sections:
+        if strtab[sh_name:strtab.index(b'\0', sh_name)] == name:
+            return data[sh_offset:sh_offset + sh_size]
+    raise ValueError('section %s is not found' % name.decode())
+
+
+def load_tokens(data):
+    """load all tokens: {ID: (level, tag, file, line, format)}"""
+    tokens = {}
+    pos = 0
+    while pos < len(data):
+        # skip the align padding between tokens
+        if data[pos] == 0:
+            pos += 1
+            continue
+        start = pos
+        fields = []
+        for _ in range(5):
+            end = data.find(b'\0', pos)
+            if end < 0:
+                end = len(data)
+            fields.append(data[pos:end].decode('utf-8', 'replace'))
+            pos = end + 1
+        # the file may have directory when the compiler doesn't support __FILE_NAME__
+        file = fields[2].replace('\\', '/').rsplit('/', 1)[-1]
+        tokens[start] = (int(fields[0]), fields[1], file, fields[3], fields[4])
+    return tokens
+
+
+class ArgsReader(object):
+    def __init__(self, args, endian, ptr_size, long_double_size):
+        self.args = args
+        self.pos = 0
+        self.endian = endian
+        self.ptr_size = ptr_size
+        self.long_double_size = long_double_size
+
+    def unpack(self, fmt, size):
+        value, = struct.unpack_from(self.endian + fmt, self.args, self.pos)
+        self.pos += size
+        return value
+
+    def string(self):
+        end = self.args.find(b'\0', self.pos)
+        if end < 0:
+            end = len(self.args)
+        value = self.args[self.pos:end].decode('utf-8', 'replace')
+        self.pos = end + 1
+        return value
+
+    def long_double(self):
+        if self.long_double_size == 8:
+            return self.unpack('d', 8)
+        # x86 80-bit extended precision, it is stored in 12 or 16 bytes
+        raw = self.args[self.pos:self.pos + 10]
+        self.pos += self.long_double_size
+        mantissa, exponent = struct.unpack(self.endian + 'QH', raw)
+        sign = -1.0 if exponent & 0x8000 else 1.0
+        exponent &= 0x7FFF
+        if exponent == 0 and mantissa == 0:
+            return sign * 0.0
+        return sign * mantissa * 2.0 ** (exponent - 16383 - 63)
+
+
+def format_log(fmt, reader):
+    """format the log by C format and packed arguments"""
+    def convert(match):
+        flags, width, precision, length, conv = match.groups()
+        if conv == '%':
+            return '%'
+        if width == '*':
+            width = str(reader.unpack('i', 4))
+        if precision == '*':
+            precision = str(reader.unpack('i', 4))
+        spec = '%' + flags + (width or '') + ('.' + precision if precision is not None else '')
+        if conv in 'di':
+            return (spec + 'd') % reader.unpack('q', 8)
+        if conv in 'uoxX':
+            value = reader.unpack('Q', 8)
+            if conv == 'o' and '#' in flags:
+                return (spec.replace('#', '') + 'o') % value if value == 0 else \
+                       (spec.replace('#', '') + 's') % ('0%o' % value)
+            return (spec + ('d' if conv == 'u' else conv)) % value
+        if conv == 'c':
+            return (spec + 'c') % (reader.unpack('i', 4) & 0xFF)
+        if conv == 's':
+            return (spec + 's') % reader.string()
+        if conv == 'p':
+            value = reader.unpack('Q' if reader.ptr_size == 8 else 'I', reader.ptr_size)
+            return (spec + 's') % ('0x%x' % value if value else '(nil)')
+        value = reader.long_double() if length == 'L' else reader.unpack('d', 8)
+        if conv in 'aA':
+            text = float.hex(value)
+            return (spec.replace('#', '') + 's') % (text.upper() if conv == 'A' else text)
+        return (spec + conv) % value
+
+    return SPEC_PATTERN.sub(convert, fmt)
+
+
+def decode(tokens, log, out, args):
+    """decode the log stream, the bytes which are not frame will be output as they are"""
+    pos = 0
+    text_start = 0
+    while pos + TOKEN_HEAD_LEN <= len(log):
+        if log[pos] != TOKEN_SYNC:
+            pos += 1
+            continue
+        args_len, token_id = struct.unpack_from(args.endian + 'HI', log, pos + 1)
+        token = tokens.get(token_id)
+        if token is None or pos + TOKEN_HEAD_LEN + args_len > len(log):
+            pos += 1
+            continue
+        out.write(log[text_start:pos].decode('utf-8', 'replace'))
+        level, tag, file, line, fmt = token
+        reader = ArgsReader(log[pos + TOKEN_HEAD_LEN:pos + TOKEN_HEAD_LEN + args_len], args.endian,
+                            args.ptr_size, args.long_double_size)
+        try:
+            msg = format_log(fmt, reader) if args_len else fmt + ' <arguments lost>'
+        except (struct.error, TypeError, ValueError):
+            msg = fmt + ' <arguments broken>'
+        level_info = LEVEL_INFO[level] if level < len(LEVEL_INFO) else '?'
+        out.write('%s/%s (%s %s) %s\n' % (level_info, tag, file, line, msg.rstrip('\n')))
+        pos += TOKEN_HEAD_LEN + args_len
+        text_start = pos
+    out.write(log[text_start:].decode('utf-8', 'replace'))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='decode the EasyLogger tokenized log')
+    parser.add_argument('token', help='firmware ELF file or the dumped elog_token section')
+    parser.add_argument('log', nargs='?', help='tokenized log file, default: stdin')
+    parser.add_argument('--ptr-size', type=int, choices=[4, 8], default=4, help='pointer size of target')
+    parser.add_argument('--long-double-size', type=int, choices=[8, 12, 16], default=8,
+                        help='long double size of target')
+    parser.add_argument('--big-endian', dest='endian', action='store_const', const='>', default='<',
+                        help='the frame head and arguments are packed in big endian')
+    args = parser.parse_args()
+
+    with open(args.token, 'rb') as f:
+        token_data = f.read()
+    if token_data[:4] == b'\x7fELF':
+        token_data = read_elf_section(token_data, TOKEN_SECTION)
+    tokens = load_tokens(token_data)
+
+    if args.log:
+        with open(args.log, 'rb') as f:
+            log = f.read()
+    else:
+        log = sys.stdin.buffer.read()
+    decode(tokens, log, sys.stdout, args)
+
+
+if __name__ == '__main__':
+    main()